@@ -0,0 +1,828 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "cjsonpp.h"
+
+using namespace cjsonpp;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedNs(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static std::string numberArray(int n)
+{
+	std::string s = "[";
+	char buf[32];
+	for (int i = 0; i < n; i++) {
+		snprintf(buf, sizeof(buf), i ? ",%d" : "%d", i);
+		s += buf;
+	}
+	return s + "]";
+}
+
+// asArray must scale linearly with the array length
+static void benchAsArray()
+{
+	printf("asArray<int>:\n");
+	for (int n = 1000; n <= 1000000; n *= 10) {
+		JSONObject arr = parse(numberArray(n));
+		Clock::time_point start = Clock::now();
+		std::vector<int> v = arr.asArray<int>();
+		double ns = elapsedNs(start);
+		printf("  %8d items %12.0f ns %6.2f ns/item\n", n, ns, ns / v.size());
+	}
+}
+
+// add()/set() append and remove() drops its bookkeeping in constant time
+static void benchBuild()
+{
+	printf("add<int> / set<int>:\n");
+	char name[32];
+	for (int n = 1000; n <= 100000; n *= 10) {
+		Clock::time_point start = Clock::now();
+		JSONObject arr = arrayObject();
+		for (int i = 0; i < n; i++)
+			arr.add(i);
+		double addNs = elapsedNs(start);
+
+		start = Clock::now();
+		JSONObject obj;
+		for (int i = 0; i < n; i++) {
+			snprintf(name, sizeof(name), "k%d", i);
+			obj.set(name, i);
+		}
+		double setNs = elapsedNs(start);
+		printf("  %8d items add %6.2f ns/item set %6.2f ns/item\n", n, addNs / n, setNs / n);
+	}
+
+	// values shared with another handle are referenced and tracked until removed
+	printf("remove(0) of shared values:\n");
+	JSONObject shared = parse("{\"a\": 1}");
+	for (int n = 1000; n <= 100000; n *= 10) {
+		JSONObject arr = arrayObject();
+		for (int i = 0; i < n; i++)
+			arr.add(shared);
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < n; i++)
+			arr.remove(0);
+		printf("  %8d items remove %6.2f ns/item\n", n, elapsedNs(start) / n);
+	}
+}
+
+// a document of records, nested values built apart and moved in or created in place
+static void benchConstruct()
+{
+	const int n = 20000;
+	const std::string name = "a moderately long customer name";
+
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < 5; r++) {
+		JSONObject doc = arrayObject();
+		for (int i = 0; i < n; i++) {
+			JSONObject rec;
+			rec.set("id", i);
+			rec.set("name", name);
+			rec.set("score", i * 0.5);
+			rec.set("active", true);
+			JSONObject tags = arrayObject();
+			tags.add("x");
+			tags.add("y");
+			rec.set("tags", std::move(tags));
+			doc.add(std::move(rec));
+		}
+	}
+	double apartNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < 5; r++) {
+		JSONObject doc = arrayObject();
+		for (int i = 0; i < n; i++) {
+			JSONObject rec = doc.emplaceObject();
+			rec.set("id", i);
+			rec.set("name", name);
+			rec.set("score", i * 0.5);
+			rec.set("active", true);
+			JSONObject tags = rec.emplaceArray("tags");
+			tags.add("x");
+			tags.add("y");
+		}
+	}
+	double inPlaceNs = elapsedNs(start);
+
+	printf("build %d records:\n  values apart %7.1f ns/record\n  in place     %7.1f ns/record\n",
+		   n, apartNs / (5.0 * n), inPlaceNs / (5.0 * n));
+}
+
+// key lookup latency, linear scan against the hash index
+static void benchLookup()
+{
+	printf("get<int>(name):\n");
+	char name[32];
+	for (int n = 10; n <= 100000; n *= 100) {
+		JSONObject obj;
+		for (int i = 0; i < n; i++) {
+			snprintf(name, sizeof(name), "key%d", i);
+			obj.set(name, i);
+		}
+		std::vector<std::string> keys;
+		for (int i = 0; i < 1000; i++) {
+			snprintf(name, sizeof(name), "key%d", (i * 7919) % n);
+			keys.push_back(name);
+		}
+
+		// linear, linear case-sensitive, indexed, indexed case-sensitive
+		double ns[4];
+		for (int pass = 0; pass < 4; pass++) {
+			if (pass == 1 || pass == 3)
+				obj.caseSensitiveKeys();
+			else
+				obj.obj()->type &= ~cJSON_CaseSensitive;
+			if (pass == 2)
+				obj.indexKeys();
+			obj.has("key0");	// builds the index
+			long sum = 0;
+			Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < keys.size(); i++)
+				sum += obj.get<int>(keys[i]);
+			ns[pass] = elapsedNs(start) / keys.size();
+			if (sum < 0)
+				printf("unexpected\n");
+		}
+		printf("  %8d keys linear %10.1f ns exact %10.1f ns indexed %6.1f ns exact %6.1f ns\n",
+			   n, ns[0], ns[1], ns[2], ns[3]);
+	}
+}
+
+// a request body of about 5 MB: objects with short strings and numbers
+static std::string requestBody()
+{
+	std::string s = "[";
+	char buf[160];
+	for (int i = 0; i < 40000; i++) {
+		snprintf(buf, sizeof(buf), "%s{\"id\": %d, \"name\": \"user%d\", \"score\": %d.5, "
+				 "\"tags\": [\"a\", \"b\"], \"active\": true}", i ? ", " : "", i, i, i % 1000);
+		s += buf;
+	}
+	return s + "]";
+}
+
+// parse and destroy, malloc per item against the arena
+static void benchArena()
+{
+	std::string body = requestBody();
+	const int rounds = 20;
+	Arena arena;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		parse(body);
+	double mallocNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		parse(body, arena);
+	double arenaNs = elapsedNs(start);
+
+	double mb = body.size() * rounds / 1e6;
+	printf("parse+destroy %.1f MB body:\n  malloc %7.1f MB/s\n  arena  %7.1f MB/s\n",
+		   body.size() / 1e6, mb / (mallocNs / 1e9), mb / (arenaNs / 1e9));
+}
+
+// a payload framed inside a receive buffer: copy out to terminate it, or parse in place
+static void benchLength()
+{
+	std::string frame = requestBody();
+	size_t len = frame.size();
+	frame += "{\"next\": \"message\"}";
+	const int rounds = 20;
+	Arena arena;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		parse(std::string(frame.data(), len).c_str(), arena);
+	double copyNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		parse(frame.data(), len, arena);
+	double boundedNs = elapsedNs(start);
+
+	double mb = len * rounds / 1e6;
+	printf("parse %.1f MB framed payload (arena):\n  copy + NUL %7.1f MB/s\n  (data, len) %7.1f MB/s\n",
+		   len / 1e6, mb / (copyNs / 1e9), mb / (boundedNs / 1e9));
+}
+
+// numeric payload: 64-bit ids and prices
+static std::string numericBody()
+{
+	std::string s = "[";
+	char buf[96];
+	for (int i = 0; i < 100000; i++) {
+		snprintf(buf, sizeof(buf), "%s[%llu, %d.%02d, %.17g]", i ? ", " : "",
+				 1000000000000000000ULL + i * 7919ULL, i % 10000, i % 100, i / 3.0);
+		s += buf;
+	}
+	return s + "]";
+}
+
+static void benchNumbers()
+{
+	std::string body = numericBody();
+	const int rounds = 10;
+	Arena arena;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		parse(body, arena);
+	double ns = elapsedNs(start);
+
+	double mb = body.size() * rounds / 1e6;
+	printf("parse %.1f MB of ids, prices and doubles (arena): %7.1f MB/s, %5.1f ns/number\n",
+		   body.size() / 1e6, mb / (ns / 1e9), ns / (rounds * 300000.0));
+}
+
+// print a 1M-number array: doubles and integers
+static void benchPrint()
+{
+	std::vector<double> doubles;
+	std::vector<int64_t> ints;
+	for (int i = 0; i < 1000000; i++) {
+		doubles.push_back(i / 7.0);
+		ints.push_back(1000000000000LL * (i % 1000) + i);
+	}
+	JSONObject darr(doubles);
+	JSONObject iarr(ints);
+
+	Clock::time_point start = Clock::now();
+	size_t dlen = darr.print(false).size();
+	double dNs = elapsedNs(start);
+
+	start = Clock::now();
+	size_t ilen = iarr.print(false).size();
+	double iNs = elapsedNs(start);
+
+	printf("print 1M numbers:\n  doubles  %6.1f ns/number %7.1f MB/s\n  integers %6.1f ns/number %7.1f MB/s\n",
+		   dNs / 1e6, dlen / (dNs / 1e3), iNs / 1e6, ilen / (iNs / 1e3));
+}
+
+// a response body printed per request: fresh strings against one reused buffer
+static void benchPrintTo()
+{
+	JSONObject doc = parse(requestBody());
+	const int rounds = 20;
+
+	Clock::time_point start = Clock::now();
+	size_t len = 0;
+	for (int i = 0; i < rounds; i++) {
+		char* json = cJSON_PrintUnformatted(doc.obj());
+		len += std::string(json).size();
+		free(json);
+	}
+	double copyNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		len += doc.print(false).size();
+	double printNs = elapsedNs(start);
+
+	std::string out;
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		len += doc.print_to(out, false);
+	double reuseNs = elapsedNs(start);
+
+	char* buf = new char[out.size() + 1];
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		len += doc.print_to(buf, out.size() + 1, false);
+	double bufNs = elapsedNs(start);
+	delete[] buf;
+
+	double mb = out.size() * rounds / 1e6;
+	printf("print %.1f MB response:\n  cJSON_PrintUnformatted + copy %7.1f MB/s\n  print()            %7.1f MB/s\n"
+		   "  print_to(string&)  %7.1f MB/s\n  print_to(buf, cap) %7.1f MB/s\n", out.size() / 1e6,
+		   mb / (copyNs / 1e9), mb / (printNs / 1e9), mb / (reuseNs / 1e9), mb / (bufNs / 1e9));
+}
+
+static long peakRssKb()
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+// a large document written to /dev/null: streamed in 64k chunks against print() + write.
+// Runs first, as the peak RSS only ever grows.
+static void benchStream()
+{
+	JSONObject doc = arrayObject();
+	for (int i = 0; i < 300000; i++) {
+		JSONObject item;
+		item.set("id", i);
+		item.set("name", "customer name number " + std::to_string(i));
+		item.set("balance", i / 7.0);
+		item.set("tags", std::vector<std::string>{"alpha", "beta", "gamma"});
+		doc.add(item);
+	}
+	int fd = open("/dev/null", O_WRONLY);
+	std::ofstream os("/dev/null", std::ios::binary);
+	long base = peakRssKb();
+
+	Clock::time_point start = Clock::now();
+	size_t len = doc.print_to_fd(fd, false);
+	double fdNs = elapsedNs(start);
+	long fdKb = peakRssKb() - base;
+
+	start = Clock::now();
+	doc.print_to(os, false);
+	double osNs = elapsedNs(start);
+	long osKb = peakRssKb() - base;
+
+	start = Clock::now();
+	std::string text = doc.print(false);
+	if (write(fd, text.data(), text.size()) != static_cast<ssize_t>(text.size()))
+		perror("write");
+	double printNs = elapsedNs(start);
+	long printKb = peakRssKb() - base;
+	close(fd);
+
+	printf("write %.1f MB document:\n  print_to_fd       %7.1f MB/s  +%ld KB peak RSS\n"
+		   "  print_to(ostream) %7.1f MB/s  +%ld KB peak RSS\n  print() + write   %7.1f MB/s  +%ld KB peak RSS\n",
+		   len / 1e6, len / (fdNs / 1e3), fdKb, len / (osNs / 1e3), osKb, len / (printNs / 1e3), printKb);
+}
+
+// read every name of a request: copied strings against views into the input parsed in situ
+static void benchInSitu()
+{
+	std::string body = requestBody();
+	const int rounds = 20;
+	size_t chars = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parse(body);
+		for (JSONObject::const_iterator it = doc.begin(); it != doc.end(); ++it)
+			chars += (*it).get<std::string>("name").size();
+	}
+	double copyNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parseInSitu(body);
+		for (JSONObject::const_iterator it = doc.begin(); it != doc.end(); ++it)
+			chars += strlen((*it).get<const char*>("name"));
+	}
+	double viewNs = elapsedNs(start);
+
+	Arena arena;
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parseInSitu(body, arena);
+		for (JSONObject::const_iterator it = doc.begin(); it != doc.end(); ++it)
+			chars += strlen((*it).get<const char*>("name"));
+	}
+	double arenaNs = elapsedNs(start);
+
+	double mb = body.size() * rounds / 1e6;
+	printf("parse %.1f MB body and read every name:\n  parse + get<std::string>          %7.1f MB/s\n"
+		   "  parseInSitu + get<const char*>    %7.1f MB/s\n  parseInSitu(arena) + get<const char*> %5.1f MB/s\n",
+		   body.size() / 1e6, mb / (copyNs / 1e9), mb / (viewNs / 1e9), mb / (arenaNs / 1e9));
+}
+
+// a routing tier: read two header fields of a large message and forward it
+static void benchLazy()
+{
+	std::string message = "{\"header\": {\"route\": \"orders\", \"id\": 12345}, \"body\": " + requestBody() + "}";
+	const int rounds = 20;
+	size_t len = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parse(message);
+		JSONObject header = doc.get<JSONObject>("header");
+		len += header.get<std::string>("route").size() + header.get<int>("id");
+	}
+	double fullNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parse(message, Lazy);
+		JSONObject header = doc.get<JSONObject>("header");
+		len += header.get<std::string>("route").size() + header.get<int>("id");
+	}
+	double lazyNs = elapsedNs(start);
+
+	std::string out;
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parse(message);
+		len += doc.get<JSONObject>("header").get<int>("id");
+		doc.print_to(out, false);
+	}
+	double fullForwardNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		JSONObject doc = parse(message, Lazy);
+		len += doc.get<JSONObject>("header").get<int>("id");
+		doc.print_to(out, false);
+	}
+	double lazyForwardNs = elapsedNs(start);
+
+	double mb = message.size() * rounds / 1e6;
+	printf("read the header of a %.1f MB message:\n  parse        %7.1f MB/s\n  parse(Lazy)  %7.1f MB/s\n"
+		   "  and forward it:\n  parse        %7.1f MB/s\n  parse(Lazy)  %7.1f MB/s\n", message.size() / 1e6,
+		   mb / (fullNs / 1e9), mb / (lazyNs / 1e9), mb / (fullForwardNs / 1e9), mb / (lazyForwardNs / 1e9));
+}
+
+// many extraction paths per message: chained get, at(pointer) and precompiled paths
+static void benchPaths()
+{
+	JSONObject doc;
+	for (int i = 0; i < 32; i++) {
+		char key[16];
+		snprintf(key, sizeof(key), "k%d", i);
+		doc.set(key, parse("{\"a\": {\"b\": [0, 1, 2, {\"c\": 42}]}}"));
+	}
+	std::vector<std::string> keys, pointers;
+	for (int i = 0; i < 32; i++) {
+		char key[16], pointer[32];
+		snprintf(key, sizeof(key), "k%d", i);
+		snprintf(pointer, sizeof(pointer), "/k%d/a/b/3/c", i);
+		keys.push_back(key);
+		pointers.push_back(pointer);
+	}
+	std::vector<CompiledPath> compiled;
+	for (size_t i = 0; i < pointers.size(); i++)
+		compiled.push_back(CompiledPath(pointers[i]));
+	const int rounds = 20000;
+	long sum = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < keys.size(); i++)
+			sum += doc.get<JSONObject>(keys[i]).get<JSONObject>("a").get<JSONObject>("b")
+				.get<JSONObject>(3).get<int>("c");
+	double chainNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < pointers.size(); i++)
+			sum += doc.at<int>(pointers[i]);
+	double atNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < compiled.size(); i++)
+			sum += doc.at<int>(compiled[i]);
+	double compiledNs = elapsedNs(start);
+
+	double n = rounds * keys.size();
+	printf("resolve a 5-hop path:\n  chained get   %7.1f ns\n  at(pointer)   %7.1f ns\n"
+		   "  CompiledPath  %7.1f ns\n", chainNs / n, atNs / n, compiledNs / n);
+}
+
+// child access: a JSONObject per child against views
+static void benchViews()
+{
+	JSONObject doc = parse("{\"items\": " + numberArray(1000) + ", \"meta\": {\"a\": {\"b\": 1}}}");
+	const int rounds = 200;
+	long sum = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		JSONObject items = doc.get<JSONObject>("items");
+		for (JSONObject::const_iterator it = items.begin(); it != items.end(); ++it)
+			sum += (*it).as<int>();
+		sum += doc.get<JSONObject>("meta").get<JSONObject>("a").get<int>("b");
+	}
+	double objectNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		JSONView items = doc.view().get<JSONView>("items");
+		for (JSONView::const_iterator it = items.begin(); it != items.end(); ++it)
+			sum += (*it).as<int>();
+		sum += doc.view().get<JSONView>("meta").get<JSONView>("a").get<int>("b");
+	}
+	double viewNs = elapsedNs(start);
+
+	double n = rounds * 1003.0;
+	printf("child access:\n  JSONObject %7.1f ns\n  JSONView   %7.1f ns\n", objectNs / n, viewNs / n);
+}
+
+// a large array arriving in 64k chunks: parsed whole once it has all arrived, against
+// element by element as the chunks come (StreamParser, Elements)
+static void benchStreamParse()
+{
+	std::string body = requestBody();
+	const size_t chunk = 65536;
+	const int rounds = 10;
+	size_t items = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		std::string received;
+		for (size_t i = 0; i < body.size(); i += chunk)
+			received.append(body, i, chunk);
+		items += parse(received).size();
+	}
+	double wholeNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		StreamParser parser(Elements);
+		JSONObject item;
+		for (size_t i = 0; i < body.size(); i += chunk) {
+			parser.feed(body.data() + i, std::min(chunk, body.size() - i));
+			while (parser.next(item))
+				items++;
+		}
+		parser.finish();
+	}
+	double streamNs = elapsedNs(start);
+
+	double mb = body.size() * rounds / 1e6;
+	printf("parse a %.1f MB array in 64k chunks:\n  buffer + parse  %7.1f MB/s\n  StreamParser    %7.1f MB/s\n",
+		   body.size() / 1e6, mb / (wholeNs / 1e9), mb / (streamNs / 1e9));
+}
+
+// parseEvents handler summing the "score" members
+struct ScoreSum: EventHandler<ScoreSum>
+{
+	double total;
+	bool inScore;
+	ScoreSum() : total(0), inScore(false) {}
+	bool key(const char* str, size_t len) { inScore = len == 5 && !memcmp(str, "score", 5); return true; }
+	bool number(double value) { if (inScore) total += value; return true; }
+};
+
+// aggregate one field: build the tree and walk it, or take the events without a tree
+static void benchEvents()
+{
+	std::string body = requestBody();
+	const int rounds = 10;
+	double total = 0;
+	Arena arena;
+
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		JSONObject doc = parse(body);
+		for (JSONObject::const_iterator it = doc.begin(); it != doc.end(); ++it)
+			total += (*it).get<double>("score");
+	}
+	double treeNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		JSONView doc = parse(body, arena).view();
+		for (JSONView::const_iterator it = doc.begin(); it != doc.end(); ++it)
+			total += (*it).get<double>("score");
+	}
+	double arenaNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++) {
+		ScoreSum sum;
+		parseEvents(body, sum);
+		total += sum.total;
+	}
+	double eventsNs = elapsedNs(start);
+
+	double mb = body.size() * rounds / 1e6;
+	printf("sum a field of %.1f MB (%.0f):\n  parse + walk    %7.1f MB/s\n  arena + views   %7.1f MB/s\n  parseEvents     %7.1f MB/s\n",
+		   body.size() / 1e6, total, mb / (treeNs / 1e9), mb / (arenaNs / 1e9), mb / (eventsNs / 1e9));
+}
+
+// an NDJSON export of about 20 MB: one record per line
+static std::string ndjsonBody()
+{
+	std::string s;
+	char buf[200];
+	for (int i = 0; i < 200000; i++) {
+		snprintf(buf, sizeof(buf), "{\"id\": %d, \"name\": \"user%d\", \"score\": %d.5, "
+				 "\"tags\": [\"a\", \"b\"], \"active\": true, \"ts\": 1700000000%03d}\n", i, i, i % 1000, i % 1000);
+		s += buf;
+	}
+	return s;
+}
+
+// NDJSON records on 1 to N threads, against splitting lines and parsing each on the caller's
+struct NdjsonScore: EventHandler<NdjsonScore>
+{
+	double total = 0;
+	bool number(double value) { total += value; return true; }
+};
+
+static void benchNdjson()
+{
+	std::string body = ndjsonBody();
+	double mb = body.size() / 1e6;
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	size_t records = 0;
+
+	Clock::time_point start = Clock::now();
+	for (size_t p = 0; p < body.size(); ) {
+		size_t e = body.find('\n', p);
+		parse(body.data() + p, e - p);
+		records++;
+		p = e + 1;
+	}
+	double splitNs = elapsedNs(start);
+	printf("NDJSON %.1f MB, %zu records (%u cores):\n  split + parse    %7.1f MB/s\n",
+		   mb, records, cores, mb / (splitNs / 1e9));
+
+	for (unsigned threads = 1; threads <= std::max(4u, cores); threads *= 2) {
+		NdjsonOptions opts;
+		opts.threads = threads;
+		start = Clock::now();
+		NdjsonReader reader(body.data(), body.size(), opts);
+		JSONObject rec;
+		while (reader.next(rec))
+			records++;
+		double readNs = elapsedNs(start);
+
+		std::vector<NdjsonScore> sums(threads);
+		start = Clock::now();
+		records += parseNdjsonEvents(body.data(), body.size(), sums);
+		double eventsNs = elapsedNs(start);
+		printf("  %2u threads: NdjsonReader %7.1f MB/s  parseNdjsonEvents %7.1f MB/s\n",
+			   threads, mb / (readNs / 1e9), mb / (eventsNs / 1e9));
+	}
+}
+
+// one large array of objects: serial parse against the index pass and runs parsed on threads
+static void benchParallel()
+{
+	std::string body = "[";
+	char buf[200];
+	for (int i = 0; i < 400000; i++) {
+		snprintf(buf, sizeof(buf), "%s{\"id\": %d, \"name\": \"user%d\", \"score\": %d.5, "
+				 "\"tags\": [\"a\", \"b\"], \"active\": true}", i ? ", " : "", i, i, i % 1000);
+		body += buf;
+	}
+	body += "]";
+	double mb = body.size() / 1e6;
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	Arena arena;
+
+	Clock::time_point start = Clock::now();
+	size_t items = parse(body).size();
+	double serialNs = elapsedNs(start);
+	start = Clock::now();
+	items += parse(body, arena).size();
+	double arenaNs = elapsedNs(start);
+	std::vector<size_t> splits(64);
+	size_t end;
+	start = Clock::now();
+	cJSON_SplitContainer(body.data(), body.size(), body.size() / 64, &splits[0], 63, &end);
+	double indexNs = elapsedNs(start);
+	printf("parse a %.1f MB array (%u cores):\n  parse           %7.1f MB/s\n  parse (arena)   %7.1f MB/s\n"
+		   "  index pass      %7.1f MB/s\n", mb, cores, mb / (serialNs / 1e9), mb / (arenaNs / 1e9), mb / (indexNs / 1e9));
+	for (unsigned threads = 2; threads <= std::max(4u, cores); threads *= 2) {
+		start = Clock::now();
+		items += parseParallel(body, threads).size();
+		printf("  %2u threads      %7.1f MB/s\n", threads, mb / (elapsedNs(start) / 1e9));
+	}
+}
+
+// whitespace and string bodies dominate: deeply indented documents and long strings.
+// Compare against a build with -DCJSON_NO_SIMD in CFLAGS for the scalar loops
+static void benchScan()
+{
+	JSONObject nested = arrayObject();
+	for (int i = 0; i < 5000; i++)
+		nested.add(parse("{\"a\": {\"b\": {\"c\": {\"d\": {\"e\": [1, \"x\", {\"f\": null}]}}}}}"));
+	std::string tabs = nested.print();
+	std::string spaces;
+	for (size_t i = 0; i < tabs.size(); i++)
+		spaces += tabs[i] == '\t' ? std::string(4, ' ') : std::string(1, tabs[i]);
+
+	std::string strings = "[";
+	for (int i = 0; i < 5000; i++) {
+		strings += i ? ", \"" : "\"";
+		for (int j = 0; j < 20 + i % 80; j++)
+			strings += "lorem ipsum dolor sit amet ";
+		strings += i % 4 ? "\"" : "\\n\\\"quoted\\\"\"";
+	}
+	strings += "]";
+
+	const std::string* corpora[] = { &tabs, &spaces, &strings };
+	const char* names[] = { "tab-indented ", "space-indented", "long strings " };
+	const int rounds = 20;
+	Arena arena;
+	printf("parse whitespace and string heavy input (arena):\n");
+	for (int c = 0; c < 3; c++) {
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < rounds; i++)
+			parse(*corpora[c], arena);
+		double ns = elapsedNs(start);
+		printf("  %s %5.1f MB %7.1f MB/s\n", names[c], corpora[c]->size() / 1e6,
+			   corpora[c]->size() * rounds / (ns / 1e3));
+	}
+}
+
+// large text fields: log lines with a few escapes, HTML with many quotes.
+// Compare against a build with -DCJSON_NO_SIMD in CFLAGS for the scalar loops
+static void benchEscape()
+{
+	JSONObject logs = arrayObject();
+	JSONObject html = arrayObject();
+	for (int i = 0; i < 5000; i++) {
+		std::string line = "2024-01-01T00:00:00Z INFO request served";
+		for (int j = 0; j < 10 + i % 40; j++)
+			line += " path=/api/v1/items status=200 bytes=1234";
+		logs.add(line + "\tfinished\n");
+		std::string page;
+		for (int j = 0; j < 5 + i % 20; j++)
+			page += "<div class=\"item\"><a href=\"/items/42\">Item title</a></div>\n";
+		html.add(page);
+	}
+	const JSONObject* docs[] = { &logs, &html };
+	const char* names[] = { "log lines", "html     " };
+	const int rounds = 20;
+	printf("print long strings:\n");
+	for (int d = 0; d < 2; d++) {
+		std::string out;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < rounds; i++)
+			docs[d]->print_to(out, false);
+		double ns = elapsedNs(start);
+		printf("  %s %5.1f MB %7.1f MB/s\n", names[d], out.size() / 1e6, out.size() * rounds / (ns / 1e3));
+	}
+}
+
+// one cached document printed over and over: growing from a guess, sized by the
+// pre-pass each time, and sized from the length of the previous print
+static void benchRepeatPrint()
+{
+	JSONObject doc = parse(requestBody());
+	const int rounds = 20;
+	size_t len = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		char* json = cJSON_PrintBuffered(doc.obj(), 256, 0);
+		len += strlen(json);
+		free(json);
+	}
+	double guessNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++) {
+		char* json = cJSON_PrintBuffered(doc.obj(), 0, 0);
+		len += strlen(json);
+		free(json);
+	}
+	double exactNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		len += doc.printed_length(false);
+	double measureNs = elapsedNs(start);
+
+	start = Clock::now();
+	for (int i = 0; i < rounds; i++)
+		len += doc.print(false).size();
+	double hintNs = elapsedNs(start);
+
+	double mb = doc.printed_length(false) * rounds / 1e6;
+	printf("print the same %.1f MB document repeatedly:\n  cJSON_PrintBuffered(256) %7.1f MB/s\n"
+		   "  cJSON_PrintBuffered(0)   %7.1f MB/s\n  printed_length()         %7.1f MB/s\n  print() with size hint   %7.1f MB/s\n",
+		   mb / rounds, mb / (guessNs / 1e9), mb / (exactNs / 1e9), mb / (measureNs / 1e9), mb / (hintNs / 1e9));
+}
+
+int main()
+{
+	benchStream();
+	benchAsArray();
+	benchBuild();
+	benchConstruct();
+	benchLookup();
+	benchArena();
+	benchLength();
+	benchScan();
+	benchInSitu();
+	benchLazy();
+	benchStreamParse();
+	benchEvents();
+	benchNdjson();
+	benchParallel();
+	benchPaths();
+	benchViews();
+	benchNumbers();
+	benchPrint();
+	benchPrintTo();
+	benchRepeatPrint();
+	benchEscape();
+	return 0;
+}
@@ -30,8 +30,15 @@
 #include <float.h>
 #include <limits.h>
 #include <ctype.h>
+#include <locale.h>
 #include "cJSON.h"
 
+/* SSE2 scanning kernels on x86, AVX2 picked at run time. Define CJSON_NO_SIMD for the portable loops only. */
+#if !defined(CJSON_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CJSON_SIMD
+#include <immintrin.h>
+#endif
+
 static const char *ep;
 
 const char *cJSON_GetErrorPtr(void) {return ep;}
@@ -46,16 +53,21 @@ static int cJSON_strcasecmp(const char *s1,const char *s2)
 static void *(*cJSON_malloc)(size_t sz) = malloc;
 static void (*cJSON_free)(void *ptr) = free;
 
-static char* cJSON_strdup(const char* str)
+/* Allocation through a per-call allocator, 0 selects the global hooks. An allocator without free_fn releases memory in bulk. */
+static void *alloc_malloc(const cJSON_Allocator *a,size_t sz)	{return a?a->malloc_fn(a->ctx,sz):cJSON_malloc(sz);}
+static void alloc_free(const cJSON_Allocator *a,void *ptr)		{if (!a) cJSON_free(ptr); else if (a->free_fn) a->free_fn(a->ctx,ptr);}
+
+static char* alloc_strdup(const char* str,const cJSON_Allocator *a)
 {
       size_t len;
       char* copy;
 
       len = strlen(str) + 1;
-      if (!(copy = (char*)cJSON_malloc(len))) return 0;
+      if (!(copy = (char*)alloc_malloc(a,len))) return 0;
       memcpy(copy,str,len);
       return copy;
 }
+static char* cJSON_strdup(const char* str) {return alloc_strdup(str,0);}
 
 void cJSON_InitHooks(cJSON_Hooks* hooks)
 {
@@ -69,67 +81,1157 @@ void cJSON_InitHooks(cJSON_Hooks* hooks)
 	cJSON_free	 = (hooks->free_fn)?hooks->free_fn:free;
 }
 
+void cJSON_FreeWithAllocator(void *ptr,const cJSON_Allocator *allocator) {if (ptr) alloc_free(allocator,ptr);}
+
+/* Arena: blocks obtained from cJSON_malloc, carved out front to back. Blocks are chained newest first.
+   Its allocator has no free_fn: items are released with the arena. */
+typedef struct arena_block {struct arena_block *next;size_t size;size_t used;} arena_block;
+struct cJSON_Arena {arena_block *head;size_t block_size;cJSON_Allocator allocator;};
+static void *arena_malloc(void *ctx,size_t sz);
+
+typedef union {double d;void *p;long l;} arena_align;
+#define ARENA_ROUND(sz) (((sz)+sizeof(arena_align)-1)/sizeof(arena_align)*sizeof(arena_align))
+#define ARENA_DATA(b) ((char*)(b)+ARENA_ROUND(sizeof(arena_block)))
+
+cJSON_Arena *cJSON_ArenaCreate(size_t block_size)
+{
+	cJSON_Arena *arena=(cJSON_Arena*)cJSON_malloc(sizeof(cJSON_Arena));
+	if (!arena) return 0;
+	arena->head=0;
+	arena->block_size=block_size?block_size:65536;
+	arena->allocator.malloc_fn=arena_malloc;
+	arena->allocator.free_fn=0;
+	arena->allocator.ctx=arena;
+	return arena;
+}
+
+const cJSON_Allocator *cJSON_ArenaAllocator(cJSON_Arena *arena) {return arena?&arena->allocator:0;}
+
+static void *arena_alloc(cJSON_Arena *arena,size_t sz)
+{
+	arena_block *b=arena->head;
+	sz=ARENA_ROUND(sz);
+	if (!b || b->size-b->used<sz)
+	{
+		size_t size=sz>arena->block_size?sz:arena->block_size;
+		if (!(b=(arena_block*)cJSON_malloc(ARENA_ROUND(sizeof(arena_block))+size))) return 0;
+		b->size=size;b->used=0;
+		b->next=arena->head;arena->head=b;
+	}
+	b->used+=sz;
+	return ARENA_DATA(b)+b->used-sz;
+}
+static void *arena_malloc(void *ctx,size_t sz) {return arena_alloc((cJSON_Arena*)ctx,sz);}
+
+void cJSON_ArenaReset(cJSON_Arena *arena)
+{
+	arena_block *b,*keep=0;
+	if (!arena) return;
+	/* keep the largest block for the next round. */
+	for (b=arena->head;b;b=b->next) if (!keep || b->size>keep->size) keep=b;
+	while ((b=arena->head)) {arena->head=b->next;if (b!=keep) cJSON_free(b);}
+	if (keep) {keep->used=0;keep->next=0;arena->head=keep;}
+}
+
+void cJSON_ArenaDestroy(cJSON_Arena *arena)
+{
+	arena_block *b;
+	if (!arena) return;
+	while ((b=arena->head)) {arena->head=b->next;cJSON_free(b);}
+	cJSON_free(arena);
+}
+
+/* Compare keys of equal length. */
+static int cJSON_strncasecmp(const char *s1,const char *s2,size_t n)
+{
+	for (;n;n--,s1++,s2++) if (*s1!=*s2 && tolower(*(const unsigned char *)s1)!=tolower(*(const unsigned char *)s2)) return 1;
+	return 0;
+}
+
+/* Key length: stringlen is kept by the API and is 0 for keys assigned by hand. */
+static size_t key_length(const cJSON *c) {return c->stringlen?c->stringlen:strlen(c->string);}
+
+static int key_equals(const cJSON *c,const char *string,size_t len,int exact)
+{
+	if (!c->string || key_length(c)!=len) return 0;
+	return exact?!memcmp(c->string,string,len):!cJSON_strncasecmp(c->string,string,len);
+}
+
+/* Hash index over the keys of an object. Open addressing with linear probing, keys hashed with the object's case sensitivity.
+   Only the first item of each key is indexed; slots==0 means the index is stale and is rebuilt on the next lookup. */
+struct cJSON_Index {int capacity;int count;int dups;int exact;cJSON **slots;const cJSON_Allocator *allocator;};
+
+/* The index uses the allocator of the tree it was created for. */
+static void *index_malloc(struct cJSON_Index *ix,size_t sz)	{return alloc_malloc(ix->allocator,sz);}
+static void index_free(struct cJSON_Index *ix,void *ptr)	{if (ptr) alloc_free(ix->allocator,ptr);}
+
+static struct cJSON_Index *index_create(cJSON *object,const cJSON_Allocator *a)
+{
+	struct cJSON_Index *ix=(struct cJSON_Index*)alloc_malloc(a,sizeof(struct cJSON_Index));
+	if (!ix) return 0;
+	memset(ix,0,sizeof(struct cJSON_Index));
+	ix->allocator=a;
+	return object->index=ix;
+}
+
+static unsigned hash_key(const char *s,size_t len,int exact)
+{
+	unsigned h=2166136261u;
+	if (exact)	for (;len;len--) h=(h^*(const unsigned char *)s++)*16777619u;
+	else		for (;len;len--) h=(h^(unsigned)tolower(*(const unsigned char *)s++))*16777619u;
+	return h;
+}
+
+static void index_drop(struct cJSON_Index *ix) {index_free(ix,ix->slots);ix->slots=0;ix->capacity=ix->count=ix->dups=0;}
+
+static cJSON **index_slot(struct cJSON_Index *ix,const char *string,size_t len)
+{
+	unsigned mask=(unsigned)ix->capacity-1,i=hash_key(string,len,ix->exact)&mask;
+	while (ix->slots[i] && !key_equals(ix->slots[i],string,len,ix->exact)) i=(i+1)&mask;
+	return &ix->slots[i];
+}
+
+static cJSON **index_item_slot(struct cJSON_Index *ix,cJSON *item) {return index_slot(ix,item->string,key_length(item));}
+
+static int index_grow(struct cJSON_Index *ix)
+{
+	int i,oldcap=ix->capacity;cJSON **old=ix->slots;
+	ix->capacity=oldcap?oldcap*2:16;
+	ix->slots=(cJSON**)index_malloc(ix,ix->capacity*sizeof(cJSON*));
+	if (!ix->slots) {ix->slots=old;ix->capacity=oldcap;index_drop(ix);return 0;}
+	memset(ix->slots,0,ix->capacity*sizeof(cJSON*));
+	for (i=0;i<oldcap;i++) if (old[i]) *index_item_slot(ix,old[i])=old[i];
+	index_free(ix,old);
+	return 1;
+}
+
+/* Index an appended item. Later duplicates of a key stay unindexed, lookups return the first one as a scan would. */
+static void index_add(struct cJSON_Index *ix,cJSON *item)
+{
+	cJSON **slot;
+	if (!ix->slots || !item->string) return;
+	if ((ix->count+1)*2>ix->capacity && !index_grow(ix)) return;
+	slot=index_item_slot(ix,item);
+	if (*slot) {ix->dups=1;return;}
+	*slot=item;ix->count++;
+}
+
+/* Unindex an item, closing the probe gap by shifting back the following entries. */
+static void index_remove(struct cJSON_Index *ix,cJSON *item)
+{
+	unsigned mask,i,j,home;cJSON **slot;
+	if (!ix->slots || !item->string) return;
+	slot=index_item_slot(ix,item);
+	if (*slot!=item) return;
+	if (ix->dups) {index_drop(ix);return;}	/* a duplicate key may have to take its place: rebuild lazily. */
+	mask=(unsigned)ix->capacity-1;i=(unsigned)(slot-ix->slots);
+	ix->slots[i]=0;ix->count--;
+	for (j=(i+1)&mask;ix->slots[j];j=(j+1)&mask)
+	{
+		home=hash_key(ix->slots[j]->string,key_length(ix->slots[j]),ix->exact)&mask;
+		if (((j-home)&mask)>=((j-i)&mask)) {ix->slots[i]=ix->slots[j];ix->slots[j]=0;i=j;}
+	}
+}
+
+/* Return the up to date index of an object, building it if needed. 0 when not indexed or out of memory. */
+static struct cJSON_Index *object_index(cJSON *object)
+{
+	struct cJSON_Index *ix=object->index;cJSON *c;int exact=(object->type&cJSON_CaseSensitive)!=0;
+	if (!(object->type&cJSON_Indexed) || (object->type&255)!=cJSON_Object) return 0;
+	if (!ix)
+	{
+		if (object->type&cJSON_IsReference) return 0;	/* references only share the index of the original. */
+		if (!(ix=index_create(object,0))) return 0;
+	}
+	if (ix->slots && ix->exact!=exact) index_drop(ix);	/* case sensitivity changed. */
+	if (!ix->slots)
+	{
+		ix->exact=exact;
+		if (!index_grow(ix)) return 0;
+		for (c=object->child;c && ix->slots;c=c->next) index_add(ix,c);
+		if (!ix->slots) return 0;
+	}
+	return ix;
+}
+
+/* Find the first item named string, using the index when it can answer. */
+static cJSON *find_key(cJSON *object,const char *string,size_t len,int exact)
+{
+	struct cJSON_Index *ix=object_index(object);cJSON *c;
+	if (ix)
+	{
+		c=*index_slot(ix,string,len);
+		if (exact==ix->exact) return c;
+		/* exact lookup in a case-insensitive index: the first case-insensitive match decides unless keys repeat. */
+		if (exact && c && key_equals(c,string,len,1)) return c;
+		if (exact && !ix->dups) return 0;
+	}
+	for (c=object->child;c && !key_equals(c,string,len,exact);c=c->next);
+	return c;
+}
+
 /* Internal constructor. */
-static cJSON *cJSON_New_Item(void)
+static cJSON *alloc_item(const cJSON_Allocator *a)
 {
-	cJSON* node = (cJSON*)cJSON_malloc(sizeof(cJSON));
+	cJSON* node = (cJSON*)alloc_malloc(a,sizeof(cJSON));
 	if (node) memset(node,0,sizeof(cJSON));
 	return node;
 }
+static cJSON *cJSON_New_Item(void) {return alloc_item(0);}
 
 /* Delete a cJSON structure. */
-void cJSON_Delete(cJSON *c)
+void cJSON_DeleteWithAllocator(cJSON *c,const cJSON_Allocator *a)
 {
 	cJSON *next;
+	if (a && !a->free_fn) return;	/* released in bulk. */
 	while (c)
 	{
 		next=c->next;
-		if (!(c->type&cJSON_IsReference) && c->child) cJSON_Delete(c->child);
-		if (!(c->type&cJSON_IsReference) && c->valuestring) cJSON_free(c->valuestring);
-		if (!(c->type&cJSON_StringIsConst) && c->string) cJSON_free(c->string);
-		cJSON_free(c);
+		if (!(c->type&cJSON_IsReference) && c->child) cJSON_DeleteWithAllocator(c->child,a);
+		if (!(c->type&(cJSON_IsReference|cJSON_ValueIsConst)) && c->valuestring) alloc_free(a,c->valuestring);
+		if (!(c->type&cJSON_StringIsConst) && c->string) alloc_free(a,c->string);
+		if (!(c->type&cJSON_IsReference) && c->index) {index_drop(c->index);index_free(c->index,c->index);}
+		alloc_free(a,c);
 		c=next;
 	}
 }
+void cJSON_Delete(cJSON *c) {cJSON_DeleteWithAllocator(c,0);}
+
+/* Per-call parser state. end bounds the input, error/reason record the first failure, insitu unescapes strings in the input,
+   depth counts the arrays and objects being parsed. */
+typedef struct {int flags;const cJSON_Allocator *allocator;const char *end;const char *error;const char *reason;int insitu;int depth;} parse_context;
+
+/* The character at p, or 0 at the end of the input. The parser never reads past ctx->end. */
+static char peek(const parse_context *ctx,const char *p) {return p<ctx->end?*p:0;}
+
+static const char *parse_fail(parse_context *ctx,const char *at,const char *reason)	{if (!ctx->reason) {ctx->error=at;ctx->reason=reason;}return 0;}
+
+/* Scanning kernels, none reads at or past end:
+   skip_ws returns the first byte that is not whitespace (1 to 32, as skip() counts it),
+   scan_string the first '"', '\\' or NUL, where a string body stops,
+   scan_escape the first control character, '"' or '\\', which the printer escapes,
+   scan_structural the first '"', bracket, brace or NUL, to match brackets outside strings. */
+static const char *skip_ws_scalar(const char *p,const char *end)		{while (p<end && (unsigned char)(*p-1)<32) p++;return p;}
+static const char *scan_string_scalar(const char *p,const char *end)	{while (p<end && *p!='\"' && *p!='\\' && *p) p++;return p;}
+static const char *scan_escape_scalar(const char *p,const char *end)	{while (p<end && (unsigned char)*p>31 && *p!='\"' && *p!='\\') p++;return p;}
+static const char *scan_structural_scalar(const char *p,const char *end)	{while (p<end && *p!='\"' && (*p|0x20)!='{' && (*p|0x20)!='}' && *p) p++;return p;}	/* '['|0x20 is '{' */
+
+#ifdef CJSON_SIMD
+static const char *skip_ws_sse2(const char *p,const char *end)
+{
+	const __m128i above=_mm_set1_epi8(33),zero=_mm_setzero_si128();
+	for (;end-p>=16;p+=16)
+	{
+		__m128i x=_mm_loadu_si128((const __m128i*)p);
+		unsigned m=(unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(x,above),x),_mm_cmpeq_epi8(x,zero)));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return skip_ws_scalar(p,end);
+}
+static const char *scan_string_sse2(const char *p,const char *end)
+{
+	const __m128i quote=_mm_set1_epi8('\"'),slash=_mm_set1_epi8('\\'),zero=_mm_setzero_si128();
+	for (;end-p>=16;p+=16)
+	{
+		__m128i x=_mm_loadu_si128((const __m128i*)p);
+		unsigned m=(unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x,quote),_mm_cmpeq_epi8(x,slash)),_mm_cmpeq_epi8(x,zero)));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return scan_string_scalar(p,end);
+}
+static const char *scan_escape_sse2(const char *p,const char *end)
+{
+	const __m128i quote=_mm_set1_epi8('\"'),slash=_mm_set1_epi8('\\'),control=_mm_set1_epi8(31);
+	for (;end-p>=16;p+=16)
+	{
+		__m128i x=_mm_loadu_si128((const __m128i*)p);
+		unsigned m=(unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x,quote),_mm_cmpeq_epi8(x,slash)),_mm_cmpeq_epi8(_mm_min_epu8(x,control),x)));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return scan_escape_scalar(p,end);
+}
+static const char *scan_structural_sse2(const char *p,const char *end)
+{
+	const __m128i quote=_mm_set1_epi8('\"'),open=_mm_set1_epi8('{'),close=_mm_set1_epi8('}'),lower=_mm_set1_epi8(0x20),zero=_mm_setzero_si128();
+	for (;end-p>=16;p+=16)
+	{
+		__m128i x=_mm_loadu_si128((const __m128i*)p),y=_mm_or_si128(x,lower);
+		unsigned m=(unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x,quote),_mm_cmpeq_epi8(x,zero)),
+			_mm_or_si128(_mm_cmpeq_epi8(y,open),_mm_cmpeq_epi8(y,close))));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return scan_structural_scalar(p,end);
+}
+__attribute__((target("avx2"))) static const char *skip_ws_avx2(const char *p,const char *end)
+{
+	const __m256i above=_mm256_set1_epi8(33),zero=_mm256_setzero_si256();
+	for (;end-p>=32;p+=32)
+	{
+		__m256i x=_mm256_loadu_si256((const __m256i*)p);
+		unsigned m=(unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(x,above),x),_mm256_cmpeq_epi8(x,zero)));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return skip_ws_sse2(p,end);
+}
+__attribute__((target("avx2"))) static const char *scan_string_avx2(const char *p,const char *end)
+{
+	const __m256i quote=_mm256_set1_epi8('\"'),slash=_mm256_set1_epi8('\\'),zero=_mm256_setzero_si256();
+	for (;end-p>=32;p+=32)
+	{
+		__m256i x=_mm256_loadu_si256((const __m256i*)p);
+		unsigned m=(unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x,quote),_mm256_cmpeq_epi8(x,slash)),_mm256_cmpeq_epi8(x,zero)));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return scan_string_sse2(p,end);
+}
+__attribute__((target("avx2"))) static const char *scan_escape_avx2(const char *p,const char *end)
+{
+	const __m256i quote=_mm256_set1_epi8('\"'),slash=_mm256_set1_epi8('\\'),control=_mm256_set1_epi8(31);
+	for (;end-p>=32;p+=32)
+	{
+		__m256i x=_mm256_loadu_si256((const __m256i*)p);
+		unsigned m=(unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x,quote),_mm256_cmpeq_epi8(x,slash)),_mm256_cmpeq_epi8(_mm256_min_epu8(x,control),x)));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return scan_escape_sse2(p,end);
+}
+__attribute__((target("avx2"))) static const char *scan_structural_avx2(const char *p,const char *end)
+{
+	const __m256i quote=_mm256_set1_epi8('\"'),open=_mm256_set1_epi8('{'),close=_mm256_set1_epi8('}'),lower=_mm256_set1_epi8(0x20),zero=_mm256_setzero_si256();
+	for (;end-p>=32;p+=32)
+	{
+		__m256i x=_mm256_loadu_si256((const __m256i*)p),y=_mm256_or_si256(x,lower);
+		unsigned m=(unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x,quote),_mm256_cmpeq_epi8(x,zero)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(y,open),_mm256_cmpeq_epi8(y,close))));
+		if (m) return p+__builtin_ctz(m);
+	}
+	return scan_structural_sse2(p,end);
+}
 
-/* Parse the input text to generate a number, and populate the result into item. */
-static const char *parse_number(cJSON *item,const char *num)
+/* The kernels for this CPU are picked once at load time, before any thread can parse: picking them lazily raced when
+   threads made their first parse at once. The _pick stubs only cover parses from other constructors that run first. */
+static const char *skip_ws_pick(const char *p,const char *end);
+static const char *scan_string_pick(const char *p,const char *end);
+static const char *scan_escape_pick(const char *p,const char *end);
+static const char *scan_structural_pick(const char *p,const char *end);
+static const char *(*skip_ws)(const char *p,const char *end)=skip_ws_pick;
+static const char *(*scan_string)(const char *p,const char *end)=scan_string_pick;
+static const char *(*scan_escape)(const char *p,const char *end)=scan_escape_pick;
+static const char *(*scan_structural)(const char *p,const char *end)=scan_structural_pick;
+__attribute__((constructor)) static void pick_kernels(void)
 {
-	double n=0,sign=1,scale=0;int subscale=0,signsubscale=1;
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))	{skip_ws=skip_ws_avx2;scan_string=scan_string_avx2;scan_escape=scan_escape_avx2;scan_structural=scan_structural_avx2;}
+	else								{skip_ws=skip_ws_sse2;scan_string=scan_string_sse2;scan_escape=scan_escape_sse2;scan_structural=scan_structural_sse2;}
+}
+static const char *skip_ws_pick(const char *p,const char *end)		{pick_kernels();return skip_ws(p,end);}
+static const char *scan_string_pick(const char *p,const char *end)	{pick_kernels();return scan_string(p,end);}
+static const char *scan_escape_pick(const char *p,const char *end)	{pick_kernels();return scan_escape(p,end);}
+static const char *scan_structural_pick(const char *p,const char *end)	{pick_kernels();return scan_structural(p,end);}
+#else
+#define skip_ws skip_ws_scalar
+#define scan_string scan_string_scalar
+#define scan_escape scan_escape_scalar
+#define scan_structural scan_structural_scalar
+#endif
+
+/* 128-bit mantissas of 5^q for q in [-342,308], normalised so the top bit is set: truncated for q>=0, rounded up for q<0.
+   The mantissa of 10^q is the same, its binary exponent is computed in eisel_lemire. Generated with the fast_float script. */
+static const uint64_t pow5_128[]={
+	0xeef453d6923bd65aull,0x113faa2906a13b3full,
+	0x9558b4661b6565f8ull,0x4ac7ca59a424c507ull,
+	0xbaaee17fa23ebf76ull,0x5d79bcf00d2df649ull,
+	0xe95a99df8ace6f53ull,0xf4d82c2c107973dcull,
+	0x91d8a02bb6c10594ull,0x79071b9b8a4be869ull,
+	0xb64ec836a47146f9ull,0x9748e2826cdee284ull,
+	0xe3e27a444d8d98b7ull,0xfd1b1b2308169b25ull,
+	0x8e6d8c6ab0787f72ull,0xfe30f0f5e50e20f7ull,
+	0xb208ef855c969f4full,0xbdbd2d335e51a935ull,
+	0xde8b2b66b3bc4723ull,0xad2c788035e61382ull,
+	0x8b16fb203055ac76ull,0x4c3bcb5021afcc31ull,
+	0xaddcb9e83c6b1793ull,0xdf4abe242a1bbf3dull,
+	0xd953e8624b85dd78ull,0xd71d6dad34a2af0dull,
+	0x87d4713d6f33aa6bull,0x8672648c40e5ad68ull,
+	0xa9c98d8ccb009506ull,0x680efdaf511f18c2ull,
+	0xd43bf0effdc0ba48ull,0x0212bd1b2566def2ull,
+	0x84a57695fe98746dull,0x014bb630f7604b57ull,
+	0xa5ced43b7e3e9188ull,0x419ea3bd35385e2dull,
+	0xcf42894a5dce35eaull,0x52064cac828675b9ull,
+	0x818995ce7aa0e1b2ull,0x7343efebd1940993ull,
+	0xa1ebfb4219491a1full,0x1014ebe6c5f90bf8ull,
+	0xca66fa129f9b60a6ull,0xd41a26e077774ef6ull,
+	0xfd00b897478238d0ull,0x8920b098955522b4ull,
+	0x9e20735e8cb16382ull,0x55b46e5f5d5535b0ull,
+	0xc5a890362fddbc62ull,0xeb2189f734aa831dull,
+	0xf712b443bbd52b7bull,0xa5e9ec7501d523e4ull,
+	0x9a6bb0aa55653b2dull,0x47b233c92125366eull,
+	0xc1069cd4eabe89f8ull,0x999ec0bb696e840aull,
+	0xf148440a256e2c76ull,0xc00670ea43ca250dull,
+	0x96cd2a865764dbcaull,0x380406926a5e5728ull,
+	0xbc807527ed3e12bcull,0xc605083704f5ecf2ull,
+	0xeba09271e88d976bull,0xf7864a44c633682eull,
+	0x93445b8731587ea3ull,0x7ab3ee6afbe0211dull,
+	0xb8157268fdae9e4cull,0x5960ea05bad82964ull,
+	0xe61acf033d1a45dfull,0x6fb92487298e33bdull,
+	0x8fd0c16206306babull,0xa5d3b6d479f8e056ull,
+	0xb3c4f1ba87bc8696ull,0x8f48a4899877186cull,
+	0xe0b62e2929aba83cull,0x331acdabfe94de87ull,
+	0x8c71dcd9ba0b4925ull,0x9ff0c08b7f1d0b14ull,
+	0xaf8e5410288e1b6full,0x07ecf0ae5ee44dd9ull,
+	0xdb71e91432b1a24aull,0xc9e82cd9f69d6150ull,
+	0x892731ac9faf056eull,0xbe311c083a225cd2ull,
+	0xab70fe17c79ac6caull,0x6dbd630a48aaf406ull,	/* 5^-300 */
+	0xd64d3d9db981787dull,0x092cbbccdad5b108ull,
+	0x85f0468293f0eb4eull,0x25bbf56008c58ea5ull,
+	0xa76c582338ed2621ull,0xaf2af2b80af6f24eull,
+	0xd1476e2c07286faaull,0x1af5af660db4aee1ull,
+	0x82cca4db847945caull,0x50d98d9fc890ed4dull,
+	0xa37fce126597973cull,0xe50ff107bab528a0ull,
+	0xcc5fc196fefd7d0cull,0x1e53ed49a96272c8ull,
+	0xff77b1fcbebcdc4full,0x25e8e89c13bb0f7aull,
+	0x9faacf3df73609b1ull,0x77b191618c54e9acull,
+	0xc795830d75038c1dull,0xd59df5b9ef6a2417ull,
+	0xf97ae3d0d2446f25ull,0x4b0573286b44ad1dull,
+	0x9becce62836ac577ull,0x4ee367f9430aec32ull,
+	0xc2e801fb244576d5ull,0x229c41f793cda73full,
+	0xf3a20279ed56d48aull,0x6b43527578c1110full,
+	0x9845418c345644d6ull,0x830a13896b78aaa9ull,
+	0xbe5691ef416bd60cull,0x23cc986bc656d553ull,
+	0xedec366b11c6cb8full,0x2cbfbe86b7ec8aa8ull,
+	0x94b3a202eb1c3f39ull,0x7bf7d71432f3d6a9ull,
+	0xb9e08a83a5e34f07ull,0xdaf5ccd93fb0cc53ull,
+	0xe858ad248f5c22c9ull,0xd1b3400f8f9cff68ull,
+	0x91376c36d99995beull,0x23100809b9c21fa1ull,
+	0xb58547448ffffb2dull,0xabd40a0c2832a78aull,
+	0xe2e69915b3fff9f9ull,0x16c90c8f323f516cull,
+	0x8dd01fad907ffc3bull,0xae3da7d97f6792e3ull,
+	0xb1442798f49ffb4aull,0x99cd11cfdf41779cull,
+	0xdd95317f31c7fa1dull,0x40405643d711d583ull,
+	0x8a7d3eef7f1cfc52ull,0x482835ea666b2572ull,
+	0xad1c8eab5ee43b66ull,0xda3243650005eecfull,
+	0xd863b256369d4a40ull,0x90bed43e40076a82ull,
+	0x873e4f75e2224e68ull,0x5a7744a6e804a291ull,
+	0xa90de3535aaae202ull,0x711515d0a205cb36ull,
+	0xd3515c2831559a83ull,0x0d5a5b44ca873e03ull,
+	0x8412d9991ed58091ull,0xe858790afe9486c2ull,
+	0xa5178fff668ae0b6ull,0x626e974dbe39a872ull,
+	0xce5d73ff402d98e3ull,0xfb0a3d212dc8128full,
+	0x80fa687f881c7f8eull,0x7ce66634bc9d0b99ull,
+	0xa139029f6a239f72ull,0x1c1fffc1ebc44e80ull,
+	0xc987434744ac874eull,0xa327ffb266b56220ull,
+	0xfbe9141915d7a922ull,0x4bf1ff9f0062baa8ull,
+	0x9d71ac8fada6c9b5ull,0x6f773fc3603db4a9ull,
+	0xc4ce17b399107c22ull,0xcb550fb4384d21d3ull,
+	0xf6019da07f549b2bull,0x7e2a53a146606a48ull,
+	0x99c102844f94e0fbull,0x2eda7444cbfc426dull,
+	0xc0314325637a1939ull,0xfa911155fefb5308ull,
+	0xf03d93eebc589f88ull,0x793555ab7eba27caull,
+	0x96267c7535b763b5ull,0x4bc1558b2f3458deull,
+	0xbbb01b9283253ca2ull,0x9eb1aaedfb016f16ull,
+	0xea9c227723ee8bcbull,0x465e15a979c1cadcull,
+	0x92a1958a7675175full,0x0bfacd89ec191ec9ull,
+	0xb749faed14125d36ull,0xcef980ec671f667bull,	/* 5^-250 */
+	0xe51c79a85916f484ull,0x82b7e12780e7401aull,
+	0x8f31cc0937ae58d2ull,0xd1b2ecb8b0908810ull,
+	0xb2fe3f0b8599ef07ull,0x861fa7e6dcb4aa15ull,
+	0xdfbdcece67006ac9ull,0x67a791e093e1d49aull,
+	0x8bd6a141006042bdull,0xe0c8bb2c5c6d24e0ull,
+	0xaecc49914078536dull,0x58fae9f773886e18ull,
+	0xda7f5bf590966848ull,0xaf39a475506a899eull,
+	0x888f99797a5e012dull,0x6d8406c952429603ull,
+	0xaab37fd7d8f58178ull,0xc8e5087ba6d33b83ull,
+	0xd5605fcdcf32e1d6ull,0xfb1e4a9a90880a64ull,
+	0x855c3be0a17fcd26ull,0x5cf2eea09a55067full,
+	0xa6b34ad8c9dfc06full,0xf42faa48c0ea481eull,
+	0xd0601d8efc57b08bull,0xf13b94daf124da26ull,
+	0x823c12795db6ce57ull,0x76c53d08d6b70858ull,
+	0xa2cb1717b52481edull,0x54768c4b0c64ca6eull,
+	0xcb7ddcdda26da268ull,0xa9942f5dcf7dfd09ull,
+	0xfe5d54150b090b02ull,0xd3f93b35435d7c4cull,
+	0x9efa548d26e5a6e1ull,0xc47bc5014a1a6dafull,
+	0xc6b8e9b0709f109aull,0x359ab6419ca1091bull,
+	0xf867241c8cc6d4c0ull,0xc30163d203c94b62ull,
+	0x9b407691d7fc44f8ull,0x79e0de63425dcf1dull,
+	0xc21094364dfb5636ull,0x985915fc12f542e4ull,
+	0xf294b943e17a2bc4ull,0x3e6f5b7b17b2939dull,
+	0x979cf3ca6cec5b5aull,0xa705992ceecf9c42ull,
+	0xbd8430bd08277231ull,0x50c6ff782a838353ull,
+	0xece53cec4a314ebdull,0xa4f8bf5635246428ull,
+	0x940f4613ae5ed136ull,0x871b7795e136be99ull,
+	0xb913179899f68584ull,0x28e2557b59846e3full,
+	0xe757dd7ec07426e5ull,0x331aeada2fe589cfull,
+	0x9096ea6f3848984full,0x3ff0d2c85def7621ull,
+	0xb4bca50b065abe63ull,0x0fed077a756b53a9ull,
+	0xe1ebce4dc7f16dfbull,0xd3e8495912c62894ull,
+	0x8d3360f09cf6e4bdull,0x64712dd7abbbd95cull,
+	0xb080392cc4349decull,0xbd8d794d96aacfb3ull,
+	0xdca04777f541c567ull,0xecf0d7a0fc5583a0ull,
+	0x89e42caaf9491b60ull,0xf41686c49db57244ull,
+	0xac5d37d5b79b6239ull,0x311c2875c522ced5ull,
+	0xd77485cb25823ac7ull,0x7d633293366b828bull,
+	0x86a8d39ef77164bcull,0xae5dff9c02033197ull,
+	0xa8530886b54dbdebull,0xd9f57f830283fdfcull,
+	0xd267caa862a12d66ull,0xd072df63c324fd7bull,
+	0x8380dea93da4bc60ull,0x4247cb9e59f71e6dull,
+	0xa46116538d0deb78ull,0x52d9be85f074e608ull,
+	0xcd795be870516656ull,0x67902e276c921f8bull,
+	0x806bd9714632dff6ull,0x00ba1cd8a3db53b6ull,
+	0xa086cfcd97bf97f3ull,0x80e8a40eccd228a4ull,
+	0xc8a883c0fdaf7df0ull,0x6122cd128006b2cdull,
+	0xfad2a4b13d1b5d6cull,0x796b805720085f81ull,
+	0x9cc3a6eec6311a63ull,0xcbe3303674053bb0ull,
+	0xc3f490aa77bd60fcull,0xbedbfc4411068a9cull,	/* 5^-200 */
+	0xf4f1b4d515acb93bull,0xee92fb5515482d44ull,
+	0x991711052d8bf3c5ull,0x751bdd152d4d1c4aull,
+	0xbf5cd54678eef0b6ull,0xd262d45a78a0635dull,
+	0xef340a98172aace4ull,0x86fb897116c87c34ull,
+	0x9580869f0e7aac0eull,0xd45d35e6ae3d4da0ull,
+	0xbae0a846d2195712ull,0x8974836059cca109ull,
+	0xe998d258869facd7ull,0x2bd1a438703fc94bull,
+	0x91ff83775423cc06ull,0x7b6306a34627ddcfull,
+	0xb67f6455292cbf08ull,0x1a3bc84c17b1d542ull,
+	0xe41f3d6a7377eecaull,0x20caba5f1d9e4a93ull,
+	0x8e938662882af53eull,0x547eb47b7282ee9cull,
+	0xb23867fb2a35b28dull,0xe99e619a4f23aa43ull,
+	0xdec681f9f4c31f31ull,0x6405fa00e2ec94d4ull,
+	0x8b3c113c38f9f37eull,0xde83bc408dd3dd04ull,
+	0xae0b158b4738705eull,0x9624ab50b148d445ull,
+	0xd98ddaee19068c76ull,0x3badd624dd9b0957ull,
+	0x87f8a8d4cfa417c9ull,0xe54ca5d70a80e5d6ull,
+	0xa9f6d30a038d1dbcull,0x5e9fcf4ccd211f4cull,
+	0xd47487cc8470652bull,0x7647c3200069671full,
+	0x84c8d4dfd2c63f3bull,0x29ecd9f40041e073ull,
+	0xa5fb0a17c777cf09ull,0xf468107100525890ull,
+	0xcf79cc9db955c2ccull,0x7182148d4066eeb4ull,
+	0x81ac1fe293d599bfull,0xc6f14cd848405530ull,
+	0xa21727db38cb002full,0xb8ada00e5a506a7cull,
+	0xca9cf1d206fdc03bull,0xa6d90811f0e4851cull,
+	0xfd442e4688bd304aull,0x908f4a166d1da663ull,
+	0x9e4a9cec15763e2eull,0x9a598e4e043287feull,
+	0xc5dd44271ad3cdbaull,0x40eff1e1853f29fdull,
+	0xf7549530e188c128ull,0xd12bee59e68ef47cull,
+	0x9a94dd3e8cf578b9ull,0x82bb74f8301958ceull,
+	0xc13a148e3032d6e7ull,0xe36a52363c1faf01ull,
+	0xf18899b1bc3f8ca1ull,0xdc44e6c3cb279ac1ull,
+	0x96f5600f15a7b7e5ull,0x29ab103a5ef8c0b9ull,
+	0xbcb2b812db11a5deull,0x7415d448f6b6f0e7ull,
+	0xebdf661791d60f56ull,0x111b495b3464ad21ull,
+	0x936b9fcebb25c995ull,0xcab10dd900beec34ull,
+	0xb84687c269ef3bfbull,0x3d5d514f40eea742ull,
+	0xe65829b3046b0afaull,0x0cb4a5a3112a5112ull,
+	0x8ff71a0fe2c2e6dcull,0x47f0e785eaba72abull,
+	0xb3f4e093db73a093ull,0x59ed216765690f56ull,
+	0xe0f218b8d25088b8ull,0x306869c13ec3532cull,
+	0x8c974f7383725573ull,0x1e414218c73a13fbull,
+	0xafbd2350644eeacfull,0xe5d1929ef90898faull,
+	0xdbac6c247d62a583ull,0xdf45f746b74abf39ull,
+	0x894bc396ce5da772ull,0x6b8bba8c328eb783ull,
+	0xab9eb47c81f5114full,0x066ea92f3f326564ull,
+	0xd686619ba27255a2ull,0xc80a537b0efefebdull,
+	0x8613fd0145877585ull,0xbd06742ce95f5f36ull,
+	0xa798fc4196e952e7ull,0x2c48113823b73704ull,
+	0xd17f3b51fca3a7a0ull,0xf75a15862ca504c5ull,	/* 5^-150 */
+	0x82ef85133de648c4ull,0x9a984d73dbe722fbull,
+	0xa3ab66580d5fdaf5ull,0xc13e60d0d2e0ebbaull,
+	0xcc963fee10b7d1b3ull,0x318df905079926a8ull,
+	0xffbbcfe994e5c61full,0xfdf17746497f7052ull,
+	0x9fd561f1fd0f9bd3ull,0xfeb6ea8bedefa633ull,
+	0xc7caba6e7c5382c8ull,0xfe64a52ee96b8fc0ull,
+	0xf9bd690a1b68637bull,0x3dfdce7aa3c673b0ull,
+	0x9c1661a651213e2dull,0x06bea10ca65c084eull,
+	0xc31bfa0fe5698db8ull,0x486e494fcff30a62ull,
+	0xf3e2f893dec3f126ull,0x5a89dba3c3efccfaull,
+	0x986ddb5c6b3a76b7ull,0xf89629465a75e01cull,
+	0xbe89523386091465ull,0xf6bbb397f1135823ull,
+	0xee2ba6c0678b597full,0x746aa07ded582e2cull,
+	0x94db483840b717efull,0xa8c2a44eb4571cdcull,
+	0xba121a4650e4ddebull,0x92f34d62616ce413ull,
+	0xe896a0d7e51e1566ull,0x77b020baf9c81d17ull,
+	0x915e2486ef32cd60ull,0x0ace1474dc1d122eull,
+	0xb5b5ada8aaff80b8ull,0x0d819992132456baull,
+	0xe3231912d5bf60e6ull,0x10e1fff697ed6c69ull,
+	0x8df5efabc5979c8full,0xca8d3ffa1ef463c1ull,
+	0xb1736b96b6fd83b3ull,0xbd308ff8a6b17cb2ull,
+	0xddd0467c64bce4a0ull,0xac7cb3f6d05ddbdeull,
+	0x8aa22c0dbef60ee4ull,0x6bcdf07a423aa96bull,
+	0xad4ab7112eb3929dull,0x86c16c98d2c953c6ull,
+	0xd89d64d57a607744ull,0xe871c7bf077ba8b7ull,
+	0x87625f056c7c4a8bull,0x11471cd764ad4972ull,
+	0xa93af6c6c79b5d2dull,0xd598e40d3dd89bcfull,
+	0xd389b47879823479ull,0x4aff1d108d4ec2c3ull,
+	0x843610cb4bf160cbull,0xcedf722a585139baull,
+	0xa54394fe1eedb8feull,0xc2974eb4ee658828ull,
+	0xce947a3da6a9273eull,0x733d226229feea32ull,
+	0x811ccc668829b887ull,0x0806357d5a3f525full,
+	0xa163ff802a3426a8ull,0xca07c2dcb0cf26f7ull,
+	0xc9bcff6034c13052ull,0xfc89b393dd02f0b5ull,
+	0xfc2c3f3841f17c67ull,0xbbac2078d443ace2ull,
+	0x9d9ba7832936edc0ull,0xd54b944b84aa4c0dull,
+	0xc5029163f384a931ull,0x0a9e795e65d4df11ull,
+	0xf64335bcf065d37dull,0x4d4617b5ff4a16d5ull,
+	0x99ea0196163fa42eull,0x504bced1bf8e4e45ull,
+	0xc06481fb9bcf8d39ull,0xe45ec2862f71e1d6ull,
+	0xf07da27a82c37088ull,0x5d767327bb4e5a4cull,
+	0x964e858c91ba2655ull,0x3a6a07f8d510f86full,
+	0xbbe226efb628afeaull,0x890489f70a55368bull,
+	0xeadab0aba3b2dbe5ull,0x2b45ac74ccea842eull,
+	0x92c8ae6b464fc96full,0x3b0b8bc90012929dull,
+	0xb77ada0617e3bbcbull,0x09ce6ebb40173744ull,
+	0xe55990879ddcaabdull,0xcc420a6a101d0515ull,
+	0x8f57fa54c2a9eab6ull,0x9fa946824a12232dull,
+	0xb32df8e9f3546564ull,0x47939822dc96abf9ull,
+	0xdff9772470297ebdull,0x59787e2b93bc56f7ull,	/* 5^-100 */
+	0x8bfbea76c619ef36ull,0x57eb4edb3c55b65aull,
+	0xaefae51477a06b03ull,0xede622920b6b23f1ull,
+	0xdab99e59958885c4ull,0xe95fab368e45ecedull,
+	0x88b402f7fd75539bull,0x11dbcb0218ebb414ull,
+	0xaae103b5fcd2a881ull,0xd652bdc29f26a119ull,
+	0xd59944a37c0752a2ull,0x4be76d3346f0495full,
+	0x857fcae62d8493a5ull,0x6f70a4400c562ddbull,
+	0xa6dfbd9fb8e5b88eull,0xcb4ccd500f6bb952ull,
+	0xd097ad07a71f26b2ull,0x7e2000a41346a7a7ull,
+	0x825ecc24c873782full,0x8ed400668c0c28c8ull,
+	0xa2f67f2dfa90563bull,0x728900802f0f32faull,
+	0xcbb41ef979346bcaull,0x4f2b40a03ad2ffb9ull,
+	0xfea126b7d78186bcull,0xe2f610c84987bfa8ull,
+	0x9f24b832e6b0f436ull,0x0dd9ca7d2df4d7c9ull,
+	0xc6ede63fa05d3143ull,0x91503d1c79720dbbull,
+	0xf8a95fcf88747d94ull,0x75a44c6397ce912aull,
+	0x9b69dbe1b548ce7cull,0xc986afbe3ee11abaull,
+	0xc24452da229b021bull,0xfbe85badce996168ull,
+	0xf2d56790ab41c2a2ull,0xfae27299423fb9c3ull,
+	0x97c560ba6b0919a5ull,0xdccd879fc967d41aull,
+	0xbdb6b8e905cb600full,0x5400e987bbc1c920ull,
+	0xed246723473e3813ull,0x290123e9aab23b68ull,
+	0x9436c0760c86e30bull,0xf9a0b6720aaf6521ull,
+	0xb94470938fa89bceull,0xf808e40e8d5b3e69ull,
+	0xe7958cb87392c2c2ull,0xb60b1d1230b20e04ull,
+	0x90bd77f3483bb9b9ull,0xb1c6f22b5e6f48c2ull,
+	0xb4ecd5f01a4aa828ull,0x1e38aeb6360b1af3ull,
+	0xe2280b6c20dd5232ull,0x25c6da63c38de1b0ull,
+	0x8d590723948a535full,0x579c487e5a38ad0eull,
+	0xb0af48ec79ace837ull,0x2d835a9df0c6d851ull,
+	0xdcdb1b2798182244ull,0xf8e431456cf88e65ull,
+	0x8a08f0f8bf0f156bull,0x1b8e9ecb641b58ffull,
+	0xac8b2d36eed2dac5ull,0xe272467e3d222f3full,
+	0xd7adf884aa879177ull,0x5b0ed81dcc6abb0full,
+	0x86ccbb52ea94baeaull,0x98e947129fc2b4e9ull,
+	0xa87fea27a539e9a5ull,0x3f2398d747b36224ull,
+	0xd29fe4b18e88640eull,0x8eec7f0d19a03aadull,
+	0x83a3eeeef9153e89ull,0x1953cf68300424acull,
+	0xa48ceaaab75a8e2bull,0x5fa8c3423c052dd7ull,
+	0xcdb02555653131b6ull,0x3792f412cb06794dull,
+	0x808e17555f3ebf11ull,0xe2bbd88bbee40bd0ull,
+	0xa0b19d2ab70e6ed6ull,0x5b6aceaeae9d0ec4ull,
+	0xc8de047564d20a8bull,0xf245825a5a445275ull,
+	0xfb158592be068d2eull,0xeed6e2f0f0d56712ull,
+	0x9ced737bb6c4183dull,0x55464dd69685606bull,
+	0xc428d05aa4751e4cull,0xaa97e14c3c26b886ull,
+	0xf53304714d9265dfull,0xd53dd99f4b3066a8ull,
+	0x993fe2c6d07b7fabull,0xe546a8038efe4029ull,
+	0xbf8fdb78849a5f96ull,0xde98520472bdd033ull,
+	0xef73d256a5c0f77cull,0x963e66858f6d4440ull,	/* 5^-50 */
+	0x95a8637627989aadull,0xdde7001379a44aa8ull,
+	0xbb127c53b17ec159ull,0x5560c018580d5d52ull,
+	0xe9d71b689dde71afull,0xaab8f01e6e10b4a6ull,
+	0x9226712162ab070dull,0xcab3961304ca70e8ull,
+	0xb6b00d69bb55c8d1ull,0x3d607b97c5fd0d22ull,
+	0xe45c10c42a2b3b05ull,0x8cb89a7db77c506aull,
+	0x8eb98a7a9a5b04e3ull,0x77f3608e92adb242ull,
+	0xb267ed1940f1c61cull,0x55f038b237591ed3ull,
+	0xdf01e85f912e37a3ull,0x6b6c46dec52f6688ull,
+	0x8b61313bbabce2c6ull,0x2323ac4b3b3da015ull,
+	0xae397d8aa96c1b77ull,0xabec975e0a0d081aull,
+	0xd9c7dced53c72255ull,0x96e7bd358c904a21ull,
+	0x881cea14545c7575ull,0x7e50d64177da2e54ull,
+	0xaa242499697392d2ull,0xdde50bd1d5d0b9e9ull,
+	0xd4ad2dbfc3d07787ull,0x955e4ec64b44e864ull,
+	0x84ec3c97da624ab4ull,0xbd5af13bef0b113eull,
+	0xa6274bbdd0fadd61ull,0xecb1ad8aeacdd58eull,
+	0xcfb11ead453994baull,0x67de18eda5814af2ull,
+	0x81ceb32c4b43fcf4ull,0x80eacf948770ced7ull,
+	0xa2425ff75e14fc31ull,0xa1258379a94d028dull,
+	0xcad2f7f5359a3b3eull,0x096ee45813a04330ull,
+	0xfd87b5f28300ca0dull,0x8bca9d6e188853fcull,
+	0x9e74d1b791e07e48ull,0x775ea264cf55347eull,
+	0xc612062576589ddaull,0x95364afe032a819eull,
+	0xf79687aed3eec551ull,0x3a83ddbd83f52205ull,
+	0x9abe14cd44753b52ull,0xc4926a9672793543ull,
+	0xc16d9a0095928a27ull,0x75b7053c0f178294ull,
+	0xf1c90080baf72cb1ull,0x5324c68b12dd6339ull,
+	0x971da05074da7beeull,0xd3f6fc16ebca5e04ull,
+	0xbce5086492111aeaull,0x88f4bb1ca6bcf585ull,
+	0xec1e4a7db69561a5ull,0x2b31e9e3d06c32e6ull,
+	0x9392ee8e921d5d07ull,0x3aff322e62439fd0ull,
+	0xb877aa3236a4b449ull,0x09befeb9fad487c3ull,
+	0xe69594bec44de15bull,0x4c2ebe687989a9b4ull,
+	0x901d7cf73ab0acd9ull,0x0f9d37014bf60a11ull,
+	0xb424dc35095cd80full,0x538484c19ef38c95ull,
+	0xe12e13424bb40e13ull,0x2865a5f206b06fbaull,
+	0x8cbccc096f5088cbull,0xf93f87b7442e45d4ull,
+	0xafebff0bcb24aafeull,0xf78f69a51539d749ull,
+	0xdbe6fecebdedd5beull,0xb573440e5a884d1cull,
+	0x89705f4136b4a597ull,0x31680a88f8953031ull,
+	0xabcc77118461cefcull,0xfdc20d2b36ba7c3eull,
+	0xd6bf94d5e57a42bcull,0x3d32907604691b4dull,
+	0x8637bd05af6c69b5ull,0xa63f9a49c2c1b110ull,
+	0xa7c5ac471b478423ull,0x0fcf80dc33721d54ull,
+	0xd1b71758e219652bull,0xd3c36113404ea4a9ull,
+	0x83126e978d4fdf3bull,0x645a1cac083126eaull,
+	0xa3d70a3d70a3d70aull,0x3d70a3d70a3d70a4ull,
+	0xccccccccccccccccull,0xcccccccccccccccdull,
+	0x8000000000000000ull,0x0000000000000000ull,	/* 5^0 */
+	0xa000000000000000ull,0x0000000000000000ull,
+	0xc800000000000000ull,0x0000000000000000ull,
+	0xfa00000000000000ull,0x0000000000000000ull,
+	0x9c40000000000000ull,0x0000000000000000ull,
+	0xc350000000000000ull,0x0000000000000000ull,
+	0xf424000000000000ull,0x0000000000000000ull,
+	0x9896800000000000ull,0x0000000000000000ull,
+	0xbebc200000000000ull,0x0000000000000000ull,
+	0xee6b280000000000ull,0x0000000000000000ull,
+	0x9502f90000000000ull,0x0000000000000000ull,
+	0xba43b74000000000ull,0x0000000000000000ull,
+	0xe8d4a51000000000ull,0x0000000000000000ull,
+	0x9184e72a00000000ull,0x0000000000000000ull,
+	0xb5e620f480000000ull,0x0000000000000000ull,
+	0xe35fa931a0000000ull,0x0000000000000000ull,
+	0x8e1bc9bf04000000ull,0x0000000000000000ull,
+	0xb1a2bc2ec5000000ull,0x0000000000000000ull,
+	0xde0b6b3a76400000ull,0x0000000000000000ull,
+	0x8ac7230489e80000ull,0x0000000000000000ull,
+	0xad78ebc5ac620000ull,0x0000000000000000ull,
+	0xd8d726b7177a8000ull,0x0000000000000000ull,
+	0x878678326eac9000ull,0x0000000000000000ull,
+	0xa968163f0a57b400ull,0x0000000000000000ull,
+	0xd3c21bcecceda100ull,0x0000000000000000ull,
+	0x84595161401484a0ull,0x0000000000000000ull,
+	0xa56fa5b99019a5c8ull,0x0000000000000000ull,
+	0xcecb8f27f4200f3aull,0x0000000000000000ull,
+	0x813f3978f8940984ull,0x4000000000000000ull,
+	0xa18f07d736b90be5ull,0x5000000000000000ull,
+	0xc9f2c9cd04674edeull,0xa400000000000000ull,
+	0xfc6f7c4045812296ull,0x4d00000000000000ull,
+	0x9dc5ada82b70b59dull,0xf020000000000000ull,
+	0xc5371912364ce305ull,0x6c28000000000000ull,
+	0xf684df56c3e01bc6ull,0xc732000000000000ull,
+	0x9a130b963a6c115cull,0x3c7f400000000000ull,
+	0xc097ce7bc90715b3ull,0x4b9f100000000000ull,
+	0xf0bdc21abb48db20ull,0x1e86d40000000000ull,
+	0x96769950b50d88f4ull,0x1314448000000000ull,
+	0xbc143fa4e250eb31ull,0x17d955a000000000ull,
+	0xeb194f8e1ae525fdull,0x5dcfab0800000000ull,
+	0x92efd1b8d0cf37beull,0x5aa1cae500000000ull,
+	0xb7abc627050305adull,0xf14a3d9e40000000ull,
+	0xe596b7b0c643c719ull,0x6d9ccd05d0000000ull,
+	0x8f7e32ce7bea5c6full,0xe4820023a2000000ull,
+	0xb35dbf821ae4f38bull,0xdda2802c8a800000ull,
+	0xe0352f62a19e306eull,0xd50b2037ad200000ull,
+	0x8c213d9da502de45ull,0x4526f422cc340000ull,
+	0xaf298d050e4395d6ull,0x9670b12b7f410000ull,
+	0xdaf3f04651d47b4cull,0x3c0cdd765f114000ull,
+	0x88d8762bf324cd0full,0xa5880a69fb6ac800ull,	/* 5^50 */
+	0xab0e93b6efee0053ull,0x8eea0d047a457a00ull,
+	0xd5d238a4abe98068ull,0x72a4904598d6d880ull,
+	0x85a36366eb71f041ull,0x47a6da2b7f864750ull,
+	0xa70c3c40a64e6c51ull,0x999090b65f67d924ull,
+	0xd0cf4b50cfe20765ull,0xfff4b4e3f741cf6dull,
+	0x82818f1281ed449full,0xbff8f10e7a8921a4ull,
+	0xa321f2d7226895c7ull,0xaff72d52192b6a0dull,
+	0xcbea6f8ceb02bb39ull,0x9bf4f8a69f764490ull,
+	0xfee50b7025c36a08ull,0x02f236d04753d5b4ull,
+	0x9f4f2726179a2245ull,0x01d762422c946590ull,
+	0xc722f0ef9d80aad6ull,0x424d3ad2b7b97ef5ull,
+	0xf8ebad2b84e0d58bull,0xd2e0898765a7deb2ull,
+	0x9b934c3b330c8577ull,0x63cc55f49f88eb2full,
+	0xc2781f49ffcfa6d5ull,0x3cbf6b71c76b25fbull,
+	0xf316271c7fc3908aull,0x8bef464e3945ef7aull,
+	0x97edd871cfda3a56ull,0x97758bf0e3cbb5acull,
+	0xbde94e8e43d0c8ecull,0x3d52eeed1cbea317ull,
+	0xed63a231d4c4fb27ull,0x4ca7aaa863ee4bddull,
+	0x945e455f24fb1cf8ull,0x8fe8caa93e74ef6aull,
+	0xb975d6b6ee39e436ull,0xb3e2fd538e122b44ull,
+	0xe7d34c64a9c85d44ull,0x60dbbca87196b616ull,
+	0x90e40fbeea1d3a4aull,0xbc8955e946fe31cdull,
+	0xb51d13aea4a488ddull,0x6babab6398bdbe41ull,
+	0xe264589a4dcdab14ull,0xc696963c7eed2dd1ull,
+	0x8d7eb76070a08aecull,0xfc1e1de5cf543ca2ull,
+	0xb0de65388cc8ada8ull,0x3b25a55f43294bcbull,
+	0xdd15fe86affad912ull,0x49ef0eb713f39ebeull,
+	0x8a2dbf142dfcc7abull,0x6e3569326c784337ull,
+	0xacb92ed9397bf996ull,0x49c2c37f07965404ull,
+	0xd7e77a8f87daf7fbull,0xdc33745ec97be906ull,
+	0x86f0ac99b4e8dafdull,0x69a028bb3ded71a3ull,
+	0xa8acd7c0222311bcull,0xc40832ea0d68ce0cull,
+	0xd2d80db02aabd62bull,0xf50a3fa490c30190ull,
+	0x83c7088e1aab65dbull,0x792667c6da79e0faull,
+	0xa4b8cab1a1563f52ull,0x577001b891185938ull,
+	0xcde6fd5e09abcf26ull,0xed4c0226b55e6f86ull,
+	0x80b05e5ac60b6178ull,0x544f8158315b05b4ull,
+	0xa0dc75f1778e39d6ull,0x696361ae3db1c721ull,
+	0xc913936dd571c84cull,0x03bc3a19cd1e38e9ull,
+	0xfb5878494ace3a5full,0x04ab48a04065c723ull,
+	0x9d174b2dcec0e47bull,0x62eb0d64283f9c76ull,
+	0xc45d1df942711d9aull,0x3ba5d0bd324f8394ull,
+	0xf5746577930d6500ull,0xca8f44ec7ee36479ull,
+	0x9968bf6abbe85f20ull,0x7e998b13cf4e1ecbull,
+	0xbfc2ef456ae276e8ull,0x9e3fedd8c321a67eull,
+	0xefb3ab16c59b14a2ull,0xc5cfe94ef3ea101eull,
+	0x95d04aee3b80ece5ull,0xbba1f1d158724a12ull,
+	0xbb445da9ca61281full,0x2a8a6e45ae8edc97ull,
+	0xea1575143cf97226ull,0xf52d09d71a3293bdull,
+	0x924d692ca61be758ull,0x593c2626705f9c56ull,	/* 5^100 */
+	0xb6e0c377cfa2e12eull,0x6f8b2fb00c77836cull,
+	0xe498f455c38b997aull,0x0b6dfb9c0f956447ull,
+	0x8edf98b59a373fecull,0x4724bd4189bd5eacull,
+	0xb2977ee300c50fe7ull,0x58edec91ec2cb657ull,
+	0xdf3d5e9bc0f653e1ull,0x2f2967b66737e3edull,
+	0x8b865b215899f46cull,0xbd79e0d20082ee74ull,
+	0xae67f1e9aec07187ull,0xecd8590680a3aa11ull,
+	0xda01ee641a708de9ull,0xe80e6f4820cc9495ull,
+	0x884134fe908658b2ull,0x3109058d147fdcddull,
+	0xaa51823e34a7eedeull,0xbd4b46f0599fd415ull,
+	0xd4e5e2cdc1d1ea96ull,0x6c9e18ac7007c91aull,
+	0x850fadc09923329eull,0x03e2cf6bc604ddb0ull,
+	0xa6539930bf6bff45ull,0x84db8346b786151cull,
+	0xcfe87f7cef46ff16ull,0xe612641865679a63ull,
+	0x81f14fae158c5f6eull,0x4fcb7e8f3f60c07eull,
+	0xa26da3999aef7749ull,0xe3be5e330f38f09dull,
+	0xcb090c8001ab551cull,0x5cadf5bfd3072cc5ull,
+	0xfdcb4fa002162a63ull,0x73d9732fc7c8f7f6ull,
+	0x9e9f11c4014dda7eull,0x2867e7fddcdd9afaull,
+	0xc646d63501a1511dull,0xb281e1fd541501b8ull,
+	0xf7d88bc24209a565ull,0x1f225a7ca91a4226ull,
+	0x9ae757596946075full,0x3375788de9b06958ull,
+	0xc1a12d2fc3978937ull,0x0052d6b1641c83aeull,
+	0xf209787bb47d6b84ull,0xc0678c5dbd23a49aull,
+	0x9745eb4d50ce6332ull,0xf840b7ba963646e0ull,
+	0xbd176620a501fbffull,0xb650e5a93bc3d898ull,
+	0xec5d3fa8ce427affull,0xa3e51f138ab4cebeull,
+	0x93ba47c980e98cdfull,0xc66f336c36b10137ull,
+	0xb8a8d9bbe123f017ull,0xb80b0047445d4184ull,
+	0xe6d3102ad96cec1dull,0xa60dc059157491e5ull,
+	0x9043ea1ac7e41392ull,0x87c89837ad68db2full,
+	0xb454e4a179dd1877ull,0x29babe4598c311fbull,
+	0xe16a1dc9d8545e94ull,0xf4296dd6fef3d67aull,
+	0x8ce2529e2734bb1dull,0x1899e4a65f58660cull,
+	0xb01ae745b101e9e4ull,0x5ec05dcff72e7f8full,
+	0xdc21a1171d42645dull,0x76707543f4fa1f73ull,
+	0x899504ae72497ebaull,0x6a06494a791c53a8ull,
+	0xabfa45da0edbde69ull,0x0487db9d17636892ull,
+	0xd6f8d7509292d603ull,0x45a9d2845d3c42b6ull,
+	0x865b86925b9bc5c2ull,0x0b8a2392ba45a9b2ull,
+	0xa7f26836f282b732ull,0x8e6cac7768d7141eull,
+	0xd1ef0244af2364ffull,0x3207d795430cd926ull,
+	0x8335616aed761f1full,0x7f44e6bd49e807b8ull,
+	0xa402b9c5a8d3a6e7ull,0x5f16206c9c6209a6ull,
+	0xcd036837130890a1ull,0x36dba887c37a8c0full,
+	0x802221226be55a64ull,0xc2494954da2c9789ull,
+	0xa02aa96b06deb0fdull,0xf2db9baa10b7bd6cull,
+	0xc83553c5c8965d3dull,0x6f92829494e5acc7ull,
+	0xfa42a8b73abbf48cull,0xcb772339ba1f17f9ull,
+	0x9c69a97284b578d7ull,0xff2a760414536efbull,	/* 5^150 */
+	0xc38413cf25e2d70dull,0xfef5138519684abaull,
+	0xf46518c2ef5b8cd1ull,0x7eb258665fc25d69ull,
+	0x98bf2f79d5993802ull,0xef2f773ffbd97a61ull,
+	0xbeeefb584aff8603ull,0xaafb550ffacfd8faull,
+	0xeeaaba2e5dbf6784ull,0x95ba2a53f983cf38ull,
+	0x952ab45cfa97a0b2ull,0xdd945a747bf26183ull,
+	0xba756174393d88dfull,0x94f971119aeef9e4ull,
+	0xe912b9d1478ceb17ull,0x7a37cd5601aab85dull,
+	0x91abb422ccb812eeull,0xac62e055c10ab33aull,
+	0xb616a12b7fe617aaull,0x577b986b314d6009ull,
+	0xe39c49765fdf9d94ull,0xed5a7e85fda0b80bull,
+	0x8e41ade9fbebc27dull,0x14588f13be847307ull,
+	0xb1d219647ae6b31cull,0x596eb2d8ae258fc8ull,
+	0xde469fbd99a05fe3ull,0x6fca5f8ed9aef3bbull,
+	0x8aec23d680043beeull,0x25de7bb9480d5854ull,
+	0xada72ccc20054ae9ull,0xaf561aa79a10ae6aull,
+	0xd910f7ff28069da4ull,0x1b2ba1518094da04ull,
+	0x87aa9aff79042286ull,0x90fb44d2f05d0842ull,
+	0xa99541bf57452b28ull,0x353a1607ac744a53ull,
+	0xd3fa922f2d1675f2ull,0x42889b8997915ce8ull,
+	0x847c9b5d7c2e09b7ull,0x69956135febada11ull,
+	0xa59bc234db398c25ull,0x43fab9837e699095ull,
+	0xcf02b2c21207ef2eull,0x94f967e45e03f4bbull,
+	0x8161afb94b44f57dull,0x1d1be0eebac278f5ull,
+	0xa1ba1ba79e1632dcull,0x6462d92a69731732ull,
+	0xca28a291859bbf93ull,0x7d7b8f7503cfdcfeull,
+	0xfcb2cb35e702af78ull,0x5cda735244c3d43eull,
+	0x9defbf01b061adabull,0x3a0888136afa64a7ull,
+	0xc56baec21c7a1916ull,0x088aaa1845b8fdd0ull,
+	0xf6c69a72a3989f5bull,0x8aad549e57273d45ull,
+	0x9a3c2087a63f6399ull,0x36ac54e2f678864bull,
+	0xc0cb28a98fcf3c7full,0x84576a1bb416a7ddull,
+	0xf0fdf2d3f3c30b9full,0x656d44a2a11c51d5ull,
+	0x969eb7c47859e743ull,0x9f644ae5a4b1b325ull,
+	0xbc4665b596706114ull,0x873d5d9f0dde1feeull,
+	0xeb57ff22fc0c7959ull,0xa90cb506d155a7eaull,
+	0x9316ff75dd87cbd8ull,0x09a7f12442d588f2ull,
+	0xb7dcbf5354e9beceull,0x0c11ed6d538aeb2full,
+	0xe5d3ef282a242e81ull,0x8f1668c8a86da5faull,
+	0x8fa475791a569d10ull,0xf96e017d694487bcull,
+	0xb38d92d760ec4455ull,0x37c981dcc395a9acull,
+	0xe070f78d3927556aull,0x85bbe253f47b1417ull,
+	0x8c469ab843b89562ull,0x93956d7478ccec8eull,
+	0xaf58416654a6babbull,0x387ac8d1970027b2ull,
+	0xdb2e51bfe9d0696aull,0x06997b05fcc0319eull,
+	0x88fcf317f22241e2ull,0x441fece3bdf81f03ull,
+	0xab3c2fddeeaad25aull,0xd527e81cad7626c3ull,
+	0xd60b3bd56a5586f1ull,0x8a71e223d8d3b074ull,
+	0x85c7056562757456ull,0xf6872d5667844e49ull,
+	0xa738c6bebb12d16cull,0xb428f8ac016561dbull,	/* 5^200 */
+	0xd106f86e69d785c7ull,0xe13336d701beba52ull,
+	0x82a45b450226b39cull,0xecc0024661173473ull,
+	0xa34d721642b06084ull,0x27f002d7f95d0190ull,
+	0xcc20ce9bd35c78a5ull,0x31ec038df7b441f4ull,
+	0xff290242c83396ceull,0x7e67047175a15271ull,
+	0x9f79a169bd203e41ull,0x0f0062c6e984d386ull,
+	0xc75809c42c684dd1ull,0x52c07b78a3e60868ull,
+	0xf92e0c3537826145ull,0xa7709a56ccdf8a82ull,
+	0x9bbcc7a142b17ccbull,0x88a66076400bb691ull,
+	0xc2abf989935ddbfeull,0x6acff893d00ea435ull,
+	0xf356f7ebf83552feull,0x0583f6b8c4124d43ull,
+	0x98165af37b2153deull,0xc3727a337a8b704aull,
+	0xbe1bf1b059e9a8d6ull,0x744f18c0592e4c5cull,
+	0xeda2ee1c7064130cull,0x1162def06f79df73ull,
+	0x9485d4d1c63e8be7ull,0x8addcb5645ac2ba8ull,
+	0xb9a74a0637ce2ee1ull,0x6d953e2bd7173692ull,
+	0xe8111c87c5c1ba99ull,0xc8fa8db6ccdd0437ull,
+	0x910ab1d4db9914a0ull,0x1d9c9892400a22a2ull,
+	0xb54d5e4a127f59c8ull,0x2503beb6d00cab4bull,
+	0xe2a0b5dc971f303aull,0x2e44ae64840fd61dull,
+	0x8da471a9de737e24ull,0x5ceaecfed289e5d2ull,
+	0xb10d8e1456105dadull,0x7425a83e872c5f47ull,
+	0xdd50f1996b947518ull,0xd12f124e28f77719ull,
+	0x8a5296ffe33cc92full,0x82bd6b70d99aaa6full,
+	0xace73cbfdc0bfb7bull,0x636cc64d1001550bull,
+	0xd8210befd30efa5aull,0x3c47f7e05401aa4eull,
+	0x8714a775e3e95c78ull,0x65acfaec34810a71ull,
+	0xa8d9d1535ce3b396ull,0x7f1839a741a14d0dull,
+	0xd31045a8341ca07cull,0x1ede48111209a050ull,
+	0x83ea2b892091e44dull,0x934aed0aab460432ull,
+	0xa4e4b66b68b65d60ull,0xf81da84d5617853full,
+	0xce1de40642e3f4b9ull,0x36251260ab9d668eull,
+	0x80d2ae83e9ce78f3ull,0xc1d72b7c6b426019ull,
+	0xa1075a24e4421730ull,0xb24cf65b8612f81full,
+	0xc94930ae1d529cfcull,0xdee033f26797b627ull,
+	0xfb9b7cd9a4a7443cull,0x169840ef017da3b1ull,
+	0x9d412e0806e88aa5ull,0x8e1f289560ee864eull,
+	0xc491798a08a2ad4eull,0xf1a6f2bab92a27e2ull,
+	0xf5b5d7ec8acb58a2ull,0xae10af696774b1dbull,
+	0x9991a6f3d6bf1765ull,0xacca6da1e0a8ef29ull,
+	0xbff610b0cc6edd3full,0x17fd090a58d32af3ull,
+	0xeff394dcff8a948eull,0xddfc4b4cef07f5b0ull,
+	0x95f83d0a1fb69cd9ull,0x4abdaf101564f98eull,
+	0xbb764c4ca7a4440full,0x9d6d1ad41abe37f1ull,
+	0xea53df5fd18d5513ull,0x84c86189216dc5edull,
+	0x92746b9be2f8552cull,0x32fd3cf5b4e49bb4ull,
+	0xb7118682dbb66a77ull,0x3fbc8c33221dc2a1ull,
+	0xe4d5e82392a40515ull,0x0fabaf3feaa5334aull,
+	0x8f05b1163ba6832dull,0x29cb4d87f2a7400eull,
+	0xb2c71d5bca9023f8ull,0x743e20e9ef511012ull,	/* 5^250 */
+	0xdf78e4b2bd342cf6ull,0x914da9246b255416ull,
+	0x8bab8eefb6409c1aull,0x1ad089b6c2f7548eull,
+	0xae9672aba3d0c320ull,0xa184ac2473b529b1ull,
+	0xda3c0f568cc4f3e8ull,0xc9e5d72d90a2741eull,
+	0x8865899617fb1871ull,0x7e2fa67c7a658892ull,
+	0xaa7eebfb9df9de8dull,0xddbb901b98feeab7ull,
+	0xd51ea6fa85785631ull,0x552a74227f3ea565ull,
+	0x8533285c936b35deull,0xd53a88958f87275full,
+	0xa67ff273b8460356ull,0x8a892abaf368f137ull,
+	0xd01fef10a657842cull,0x2d2b7569b0432d85ull,
+	0x8213f56a67f6b29bull,0x9c3b29620e29fc73ull,
+	0xa298f2c501f45f42ull,0x8349f3ba91b47b8full,
+	0xcb3f2f7642717713ull,0x241c70a936219a73ull,
+	0xfe0efb53d30dd4d7ull,0xed238cd383aa0110ull,
+	0x9ec95d1463e8a506ull,0xf4363804324a40aaull,
+	0xc67bb4597ce2ce48ull,0xb143c6053edcd0d5ull,
+	0xf81aa16fdc1b81daull,0xdd94b7868e94050aull,
+	0x9b10a4e5e9913128ull,0xca7cf2b4191c8326ull,
+	0xc1d4ce1f63f57d72ull,0xfd1c2f611f63a3f0ull,
+	0xf24a01a73cf2dccfull,0xbc633b39673c8cecull,
+	0x976e41088617ca01ull,0xd5be0503e085d813ull,
+	0xbd49d14aa79dbc82ull,0x4b2d8644d8a74e18ull,
+	0xec9c459d51852ba2ull,0xddf8e7d60ed1219eull,
+	0x93e1ab8252f33b45ull,0xcabb90e5c942b503ull,
+	0xb8da1662e7b00a17ull,0x3d6a751f3b936243ull,
+	0xe7109bfba19c0c9dull,0x0cc512670a783ad4ull,
+	0x906a617d450187e2ull,0x27fb2b80668b24c5ull,
+	0xb484f9dc9641e9daull,0xb1f9f660802dedf6ull,
+	0xe1a63853bbd26451ull,0x5e7873f8a0396973ull,
+	0x8d07e33455637eb2ull,0xdb0b487b6423e1e8ull,
+	0xb049dc016abc5e5full,0x91ce1a9a3d2cda62ull,
+	0xdc5c5301c56b75f7ull,0x7641a140cc7810fbull,
+	0x89b9b3e11b6329baull,0xa9e904c87fcb0a9dull,
+	0xac2820d9623bf429ull,0x546345fa9fbdcd44ull,
+	0xd732290fbacaf133ull,0xa97c177947ad4095ull,
+	0x867f59a9d4bed6c0ull,0x49ed8eabcccc485dull,
+	0xa81f301449ee8c70ull,0x5c68f256bfff5a74ull,
+	0xd226fc195c6a2f8cull,0x73832eec6fff3111ull,
+	0x83585d8fd9c25db7ull,0xc831fd53c5ff7eabull,
+	0xa42e74f3d032f525ull,0xba3e7ca8b77f5e55ull,
+	0xcd3a1230c43fb26full,0x28ce1bd2e55f35ebull,
+	0x80444b5e7aa7cf85ull,0x7980d163cf5b81b3ull,
+	0xa0555e361951c366ull,0xd7e105bcc332621full,
+	0xc86ab5c39fa63440ull,0x8dd9472bf3fefaa7ull,
+	0xfa856334878fc150ull,0xb14f98f6f0feb951ull,
+	0x9c935e00d4b9d8d2ull,0x6ed1bf9a569f33d3ull,
+	0xc3b8358109e84f07ull,0x0a862f80ec4700c8ull,
+	0xf4a642e14c6262c8ull,0xcd27bb612758c0faull,
+	0x98e7e9cccfbd7dbdull,0x8038d51cb897789cull,
+	0xbf21e44003acdd2cull,0xe0470a63e6bd56c3ull,	/* 5^300 */
+	0xeeea5d5004981478ull,0x1858ccfce06cac74ull,
+	0x95527a5202df0ccbull,0x0f37801e0c43ebc8ull,
+	0xbaa718e68396cffdull,0xd30560258f54e6baull,
+	0xe950df20247c83fdull,0x47c6b82ef32a2069ull,
+	0x91d28b7416cdd27eull,0x4cdc331d57fa5441ull,
+	0xb6472e511c81471dull,0xe0133fe4adf8e952ull,
+	0xe3d8f9e563a198e5ull,0x58180fddd97723a6ull,
+	0x8e679c2f5e44ff8full,0x570f09eaa7ea7648ull,
+};
+
+/* Full product of a and b: returns the low 64 bits, *hi gets the high ones. */
+static uint64_t mul_128(uint64_t a,uint64_t b,uint64_t *hi)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ typedef unsigned __int128 uint128;
+	uint128 r=(uint128)a*b;
+	*hi=(uint64_t)(r>>64);return (uint64_t)r;
+#else
+	uint64_t a0=(uint32_t)a,a1=a>>32,b0=(uint32_t)b,b1=b>>32;
+	uint64_t p00=a0*b0,p01=a0*b1,p10=a1*b0,p11=a1*b1;
+	uint64_t mid=(p00>>32)+(uint32_t)p01+(uint32_t)p10;
+	*hi=p11+(p01>>32)+(p10>>32)+(mid>>32);
+	return (mid<<32)|(uint32_t)p00;
+#endif
+}
+
+static int clz_64(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_clzll(x);
+#else
+	int n=0;while (!(x&((uint64_t)1<<63))) x<<=1,n++;return n;
+#endif
+}
 
-	if (*num=='-') sign=-1,num++;	/* Has sign? */
-	if (*num=='0') num++;			/* is zero */
-	if (*num>='1' && *num<='9')	do	n=(n*10.0)+(*num++ -'0');	while (*num>='0' && *num<='9');	/* Number? */
-	if (*num=='.' && num[1]>='0' && num[1]<='9') {num++;		do	n=(n*10.0)+(*num++ -'0'),scale--; while (*num>='0' && *num<='9');}	/* Fractional part? */
-	if (*num=='e' || *num=='E')		/* Exponent? */
-	{	num++;if (*num=='+') num++;	else if (*num=='-') signsubscale=-1,num++;		/* With sign? */
-		while (*num>='0' && *num<='9') subscale=(subscale*10)+(*num++ - '0');	/* Number? */
+/* w*10^q correctly rounded, for w>0 (Eisel-Lemire). Returns 0 in the rare cases it can't decide. */
+static int eisel_lemire(uint64_t w,int q,double *out)
+{
+	uint64_t lo,hi,hi2,mant,bits;int lz,upper,exp2;
+	if (q<-342) {*out=0;return 1;}
+	if (q>308) {*out=HUGE_VAL;return 1;}
+	lz=clz_64(w);w<<=lz;
+	lo=mul_128(w,pow5_128[2*(q+342)],&hi);
+	if ((hi&0x1FF)==0x1FF) {mul_128(w,pow5_128[2*(q+342)+1],&hi2);lo+=hi2;if (hi2>lo) hi++;}	/* the low bits may carry into the result. */
+	if (lo==UINT64_MAX && (q<-27 || q>55)) return 0;
+	upper=(int)(hi>>63);
+	mant=hi>>(upper+9);
+	exp2=((217706*q)>>16)+63+upper-lz+1023;
+	if (exp2<=0)	/* subnormal */
+	{
+		if (-exp2+1>=64) {*out=0;return 1;}
+		mant>>=-exp2+1;mant+=mant&1;mant>>=1;
+		bits=((uint64_t)(mant>=((uint64_t)1<<52))<<52)|(mant&(((uint64_t)1<<52)-1));
+		memcpy(out,&bits,sizeof(bits));return 1;
 	}
+	if (lo<=1 && q>=-4 && q<=23 && (mant&3)==1 && (mant<<(upper+9))==hi) mant&=~(uint64_t)1;	/* exactly halfway: round to even. */
+	mant+=mant&1;mant>>=1;
+	if (mant>=((uint64_t)2<<52)) {mant=(uint64_t)1<<52;exp2++;}
+	if (exp2>=0x7FF) {*out=HUGE_VAL;return 1;}
+	bits=((uint64_t)exp2<<52)|(mant&~((uint64_t)1<<52));
+	memcpy(out,&bits,sizeof(bits));return 1;
+}
+
+/* Powers of ten exactly representable as doubles, for the w*10^q and w/10^-q fast path. */
+static const double exact_pow10[]={1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+/* Slow path: strtod on a NUL-terminated copy, with the decimal point of the C locale. */
+static double parse_double_slow(const char *start,size_t len,const parse_context *ctx)
+{
+	char local[64],*buf=local,point=localeconv()->decimal_point[0];double n;size_t i;
+	if (len>=sizeof(local) && !(buf=(char*)alloc_malloc(ctx->allocator,len+1))) return 0;
+	for (i=0;i<len;i++) buf[i]=start[i]=='.'?point:start[i];
+	buf[len]=0;
+	n=strtod(buf,0);
+	if (buf!=local) alloc_free(ctx->allocator,buf);
+	return n;
+}
+
+/* Parse the input text to generate a number, and populate the result into item.
+   Integers that fit 64 bits keep their exact value in valueint64, other numbers are rounded correctly.
+   A sign, point or exponent without digits fails, so no value is made from it. */
+static const char *parse_number(cJSON *item,const char *num,parse_context *ctx)
+{
+	const char *start=num;uint64_t w=0;int neg=0,q=0,e=0,esign=1,integer=1,digits=0,full=0,truncated=0;double n,n2;char c;
+
+	if (peek(ctx,num)=='-') neg=1,num++;	/* Has sign? */
+	if ((c=peek(ctx,num))<'0' || c>'9') return parse_fail(ctx,start,"invalid number");
+	if (c=='0') c=peek(ctx,++num);	/* is zero */
+	if (c>='1' && c<='9')	do	{if (digits<19) w=w*10+(c-'0'),digits++; else if (!full && w<=(UINT64_MAX-(c-'0'))/10) w=w*10+(c-'0'); else full=1,truncated|=c!='0',q++;c=peek(ctx,++num);}	while (c>='0' && c<='9');	/* Number? */
+	if (c=='.')	/* Fractional part? */
+	{	integer=0;c=peek(ctx,++num);if (c<'0' || c>'9') return parse_fail(ctx,start,"invalid number");
+		do	{if (digits<19) w=w*10+(c-'0'),q--,digits+=w!=0; else if (!full && w<=(UINT64_MAX-(c-'0'))/10) w=w*10+(c-'0'),q--; else full=1,truncated|=c!='0';c=peek(ctx,++num);}	while (c>='0' && c<='9');
+	}
+	if (c=='e' || c=='E')		/* Exponent? */
+	{	integer=0;c=peek(ctx,++num);if (c=='+') c=peek(ctx,++num);	else if (c=='-') esign=-1,c=peek(ctx,++num);		/* With sign? */
+		if (c<'0' || c>'9') return parse_fail(ctx,start,"invalid number");
+		while (c>='0' && c<='9') {if (e<100000) e=(e*10)+(c-'0');c=peek(ctx,++num);}	/* Number? */
+	}
+	q+=esign*e;
 
-	n=sign*n*pow(10.0,(scale+subscale*signsubscale));	/* number = +/- number.fraction * 10^+/- exponent */
-	
-	item->valuedouble=n;
-	item->valueint=(int)n;
 	item->type=cJSON_Number;
+	if (integer && !q)
+	{
+		n=(double)w;
+		if (!neg && w<=INT64_MAX)		item->type|=cJSON_Int64,item->valueint64=(int64_t)w;
+		else if (!neg)					item->type|=cJSON_Int64|cJSON_Uint64,item->valueint64=(int64_t)(w-INT64_MAX-1)+INT64_MIN;
+		else if (w<=(uint64_t)INT64_MAX+1)	item->type|=cJSON_Int64,item->valueint64=w?-(int64_t)(w-1)-1:0;
+	}
+	else if (!w)													n=0;
+	else if (!truncated && w<=((uint64_t)1<<53) && q>=-22 && q<=22)	n=q<0?(double)w/exact_pow10[-q]:(double)w*exact_pow10[q];	/* both operands exact: one rounding. */
+	else if (!truncated && eisel_lemire(w,q,&n))					;
+	else if (truncated && w<UINT64_MAX && eisel_lemire(w,q,&n) && eisel_lemire(w+1,q,&n2) && n==n2)	;	/* dropped digits can't change the result. */
+	else n=fabs(parse_double_slow(start,num-start,ctx));
+	if (neg) n=-n;
+
+	item->valuedouble=n;
+	item->valueint=n>=INT_MAX?INT_MAX:n<=INT_MIN?INT_MIN:(int)n;
 	return num;
 }
 
 static int pow2gt (int x)	{	--x;	x|=x>>1;	x|=x>>2;	x|=x>>4;	x|=x>>8;	x|=x>>16;	return x+1;	}
 
-typedef struct {char *buffer; int length; int offset; } printbuffer;
+/* Output buffer. With a sink, full buffers are handed to it and reused; with resize, the caller's memory grows in place. */
+typedef struct {char *buffer; int length; int offset; const cJSON_Allocator *allocator;
+	const cJSON_Sink *sink; size_t written;
+	char *(*resize)(void *ctx,char *buffer,size_t size); void *resize_ctx; } printbuffer;
 
 static char* ensure(printbuffer *p,int needed)
 {
 	char *newbuffer;int newsize;
 	if (!p || !p->buffer) return 0;
+	if (p->sink && p->offset && needed+p->offset>p->length)	/* everything before offset is final */
+	{
+		if (!p->sink->write(p->sink->ctx,p->buffer,p->offset)) {alloc_free(p->allocator,p->buffer);p->length=0,p->buffer=0;return 0;}
+		p->written+=p->offset;p->offset=0;
+	}
 	needed+=p->offset;
 	if (needed<=p->length) return p->buffer+p->offset;
 
 	newsize=pow2gt(needed);
-	newbuffer=(char*)cJSON_malloc(newsize);
-	if (!newbuffer) {cJSON_free(p->buffer);p->length=0,p->buffer=0;return 0;}
+	if (p->resize)
+	{
+		if (!(newbuffer=p->resize(p->resize_ctx,p->buffer,newsize))) {p->length=0,p->buffer=0;return 0;}
+		p->length=newsize;
+		p->buffer=newbuffer;
+		return newbuffer+p->offset;
+	}
+	newbuffer=(char*)alloc_malloc(p->allocator,newsize);
+	if (!newbuffer) {alloc_free(p->allocator,p->buffer);p->length=0,p->buffer=0;return 0;}
 	if (newbuffer) memcpy(newbuffer,p->buffer,p->length);
-	cJSON_free(p->buffer);
+	alloc_free(p->allocator,p->buffer);
 	p->length=newsize;
 	p->buffer=newbuffer;
 	return newbuffer+p->offset;
@@ -143,34 +1245,177 @@ static int update(printbuffer *p)
 	return p->offset+strlen(str);
 }
 
-/* Render the number nicely from the given item into a string. */
-static char *print_number(cJSON *item,printbuffer *p)
+/* "00" to "99", for writing integers two digits at a time. */
+static const char digit_pairs[]=
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/* Write v in decimal, returns the end. */
+static char *print_uint64(char *str,uint64_t v)
 {
-	char *str=0;
-	double d=item->valuedouble;
-	if (d==0)
+	char tmp[20],*t=tmp+20;unsigned i;
+	while (v>=100) {i=(unsigned)(v%100)*2;v/=100;*--t=digit_pairs[i+1];*--t=digit_pairs[i];}
+	if (v>=10) {i=(unsigned)v*2;*--t=digit_pairs[i+1];*--t=digit_pairs[i];}
+	else *--t=(char)('0'+v);
+	memcpy(str,t,tmp+20-t);
+	return str+(tmp+20-t);
+}
+static char *print_int64(char *str,int64_t v)	{if (v<0) {*str++='-';return print_uint64(str,(uint64_t)0-(uint64_t)v);}return print_uint64(str,(uint64_t)v);}
+
+/* 64-bit significands and binary exponents of 10^k for k=-348,-340,...,340, rounded to nearest. */
+static const uint64_t cached_pow10_f[]={
+	0xfa8fd5a0081c0288ull,0xbaaee17fa23ebf76ull,0x8b16fb203055ac76ull,0xcf42894a5dce35eaull,
+	0x9a6bb0aa55653b2dull,0xe61acf033d1a45dfull,0xab70fe17c79ac6caull,0xff77b1fcbebcdc4full,
+	0xbe5691ef416bd60cull,0x8dd01fad907ffc3cull,0xd3515c2831559a83ull,0x9d71ac8fada6c9b5ull,
+	0xea9c227723ee8bcbull,0xaecc49914078536dull,0x823c12795db6ce57ull,0xc21094364dfb5637ull,
+	0x9096ea6f3848984full,0xd77485cb25823ac7ull,0xa086cfcd97bf97f4ull,0xef340a98172aace5ull,
+	0xb23867fb2a35b28eull,0x84c8d4dfd2c63f3bull,0xc5dd44271ad3cdbaull,0x936b9fcebb25c996ull,
+	0xdbac6c247d62a584ull,0xa3ab66580d5fdaf6ull,0xf3e2f893dec3f126ull,0xb5b5ada8aaff80b8ull,
+	0x87625f056c7c4a8bull,0xc9bcff6034c13053ull,0x964e858c91ba2655ull,0xdff9772470297ebdull,
+	0xa6dfbd9fb8e5b88full,0xf8a95fcf88747d94ull,0xb94470938fa89bcfull,0x8a08f0f8bf0f156bull,
+	0xcdb02555653131b6ull,0x993fe2c6d07b7facull,0xe45c10c42a2b3b06ull,0xaa242499697392d3ull,
+	0xfd87b5f28300ca0eull,0xbce5086492111aebull,0x8cbccc096f5088ccull,0xd1b71758e219652cull,
+	0x9c40000000000000ull,0xe8d4a51000000000ull,0xad78ebc5ac620000ull,0x813f3978f8940984ull,
+	0xc097ce7bc90715b3ull,0x8f7e32ce7bea5c70ull,0xd5d238a4abe98068ull,0x9f4f2726179a2245ull,
+	0xed63a231d4c4fb27ull,0xb0de65388cc8ada8ull,0x83c7088e1aab65dbull,0xc45d1df942711d9aull,
+	0x924d692ca61be758ull,0xda01ee641a708deaull,0xa26da3999aef774aull,0xf209787bb47d6b85ull,
+	0xb454e4a179dd1877ull,0x865b86925b9bc5c2ull,0xc83553c5c8965d3dull,0x952ab45cfa97a0b3ull,
+	0xde469fbd99a05fe3ull,0xa59bc234db398c25ull,0xf6c69a72a3989f5cull,0xb7dcbf5354e9beceull,
+	0x88fcf317f22241e2ull,0xcc20ce9bd35c78a5ull,0x98165af37b2153dfull,0xe2a0b5dc971f303aull,
+	0xa8d9d1535ce3b396ull,0xfb9b7cd9a4a7443cull,0xbb764c4ca7a44410ull,0x8bab8eefb6409c1aull,
+	0xd01fef10a657842cull,0x9b10a4e5e9913129ull,0xe7109bfba19c0c9dull,0xac2820d9623bf429ull,
+	0x80444b5e7aa7cf85ull,0xbf21e44003acdd2dull,0x8e679c2f5e44ff8full,0xd433179d9c8cb841ull,
+	0x9e19db92b4e31ba9ull,0xeb96bf6ebadf77d9ull,0xaf87023b9bf0ee6bull,
+};
+static const short cached_pow10_e[]={
+	-1220,-1193,-1166,-1140,-1113,-1087,-1060,-1034,-1007,-980,-954,-927,-901,-874,-847,-821,
+	-794,-768,-741,-715,-688,-661,-635,-608,-582,-555,-529,-502,-475,-449,-422,-396,
+	-369,-343,-316,-289,-263,-236,-210,-183,-157,-130,-103,-77,-50,-24,3,30,
+	56,83,109,136,162,189,216,242,269,295,322,348,375,402,428,455,
+	481,508,534,561,588,614,641,667,694,720,747,774,800,827,853,880,
+	907,933,960,986,1013,1039,1066,
+};
+
+static const uint64_t pow10_u64[]={1ull,10ull,100ull,1000ull,10000ull,100000ull,1000000ull,10000000ull,100000000ull,1000000000ull,
+	10000000000ull,100000000000ull,1000000000000ull,10000000000000ull,100000000000000ull,1000000000000000ull,
+	10000000000000000ull,100000000000000000ull,1000000000000000000ull,10000000000000000000ull};
+
+/* A floating point number f*2^e with a 64-bit significand. */
+typedef struct {uint64_t f;int e;} diy_fp;
+
+static diy_fp diy_mul(diy_fp a,diy_fp b)	{diy_fp r;uint64_t lo=mul_128(a.f,b.f,&r.f);if (lo>>63) r.f++;r.e=a.e+b.e+64;return r;}
+static diy_fp diy_normalize(diy_fp a)		{while (!(a.f>>63)) a.f<<=1,a.e--;return a;}
+
+static int count_digits32(uint32_t n)	{int k=1;while (k<10 && n>=pow10_u64[k]) k++;return k;}
+
+static void grisu_round(char *buf,int len,uint64_t delta,uint64_t rest,uint64_t ten_kappa,uint64_t wp_w)
+{
+	while (rest<wp_w && delta-rest>=ten_kappa && (rest+ten_kappa<wp_w || wp_w-rest>rest+ten_kappa-wp_w)) buf[len-1]--,rest+=ten_kappa;
+}
+
+/* Grisu2: the digits of v>0, at most 17, such that digits*10^K reads back as v. Almost always the shortest such digits. */
+static int grisu2(double v,char *buf,int *K)
+{
+	uint64_t bits,delta,p2,wp_w;uint32_t p1,d;diy_fp w,wp,wm,c,one;int be,kappa,len=0,k;double dk;
+
+	memcpy(&bits,&v,sizeof(bits));
+	be=(int)((bits>>52)&0x7FF);w.f=bits&(((uint64_t)1<<52)-1);
+	if (be) w.f+=(uint64_t)1<<52,w.e=be-1075; else w.e=-1074;
+
+	/* the boundaries halfway to the neighbouring doubles, with the exponent of the upper one */
+	wp.f=(w.f<<1)+1;wp.e=w.e-1;
+	while (!(wp.f&((uint64_t)1<<53))) wp.f<<=1,wp.e--;
+	wp.f<<=10;wp.e-=10;
+	if (w.f==((uint64_t)1<<52))	wm.f=(w.f<<2)-1,wm.e=w.e-2;	/* the lower neighbour is closer */
+	else						wm.f=(w.f<<1)-1,wm.e=w.e-1;
+	wm.f<<=wm.e-wp.e;wm.e=wp.e;
+
+	/* scale by a cached 10^-K so the upper boundary's exponent lands in [-60,-32] */
+	dk=(-61-wp.e)*0.30102999566398114+347;
+	k=(int)dk;if (dk-k>0.0) k++;
+	k=(k>>3)+1;
+	*K=-(-348+k*8);
+	c.f=cached_pow10_f[k];c.e=cached_pow10_e[k];
+	w=diy_mul(diy_normalize(w),c);wp=diy_mul(wp,c);wm=diy_mul(wm,c);
+	wm.f++;wp.f--;
+	delta=wp.f-wm.f;
+
+	/* generate digits of wp until they are within delta */
+	one.e=wp.e;one.f=(uint64_t)1<<-one.e;
+	wp_w=wp.f-w.f;
+	p1=(uint32_t)(wp.f>>-one.e);
+	p2=wp.f&(one.f-1);
+	kappa=count_digits32(p1);
+	while (kappa>0)
 	{
-		if (p)	str=ensure(p,2);
-		else	str=(char*)cJSON_malloc(2);	/* special case for 0. */
-		if (str) strcpy(str,"0");
+		d=p1/(uint32_t)pow10_u64[kappa-1];p1%=(uint32_t)pow10_u64[kappa-1];
+		if (d || len) buf[len++]=(char)('0'+d);
+		kappa--;
+		if ((((uint64_t)p1)<<-one.e)+p2<=delta)
+		{
+			*K+=kappa;
+			grisu_round(buf,len,delta,(((uint64_t)p1)<<-one.e)+p2,pow10_u64[kappa]<<-one.e,wp_w);
+			return len;
+		}
 	}
-	else if (fabs(((double)item->valueint)-d)<=DBL_EPSILON && d<=INT_MAX && d>=INT_MIN)
+	for (;;)
 	{
-		if (p)	str=ensure(p,21);
-		else	str=(char*)cJSON_malloc(21);	/* 2^64+1 can be represented in 21 chars. */
-		if (str)	sprintf(str,"%d",item->valueint);
+		p2*=10;delta*=10;
+		d=(uint32_t)(p2>>-one.e);
+		if (d || len) buf[len++]=(char)('0'+d);
+		p2&=one.f-1;
+		kappa--;
+		if (p2<delta)
+		{
+			*K+=kappa;
+			grisu_round(buf,len,delta,p2,one.f,-kappa<20?wp_w*pow10_u64[-kappa]:0);
+			return len;
+		}
 	}
+}
+
+/* Lay out digits*10^K the way JavaScript does: plain up to 21 integer digits or 6 leading zeros, exponent otherwise. */
+static char *print_digits(char *str,const char *digits,int len,int K)
+{
+	int point=len+K,exp10=point-1;
+	if (K>=0 && point<=21)	{memcpy(str,digits,len);memset(str+len,'0',K);return str+point;}
+	if (point>0 && point<=21)	{memcpy(str,digits,point);str[point]='.';memcpy(str+point+1,digits+point,len-point);return str+len+1;}
+	if (point>-6 && point<=0)	{str[0]='0';str[1]='.';memset(str+2,'0',-point);memcpy(str+2-point,digits,len);return str+2-point+len;}
+	*str++=digits[0];
+	if (len>1) {*str++='.';memcpy(str,digits+1,len-1);str+=len-1;}
+	*str++='e';*str++=exp10<0?'-':'+';
+	return print_uint64(str,(uint64_t)(exp10<0?-exp10:exp10));
+}
+
+/* Render the number nicely from the given item into a string: exact integers, the shortest digits that read back otherwise.
+   str holds 32 bytes, the longest is -d.dddddddddddddddde-308. Returns the length. */
+static int format_number(cJSON *item,char *str)
+{
+	char *end,digits[20];int len,K;
+	double d=item->valuedouble;
+	if (item->type&cJSON_Uint64)			end=print_uint64(str,(uint64_t)item->valueint64);
+	else if (item->type&cJSON_Int64)		end=print_int64(str,item->valueint64);
+	else if (isnan(d) || isinf(d))			{strcpy(str,"null");end=str+4;}	/* no JSON form. */
+	else if (fabs(d)<9007199254740992.0 && d==(double)(int64_t)d)	end=print_int64(str,(int64_t)d);
 	else
 	{
-		if (p)	str=ensure(p,64);
-		else	str=(char*)cJSON_malloc(64);	/* This is a nice tradeoff. */
-		if (str)
-		{
-			if (fabs(floor(d)-d)<=DBL_EPSILON && fabs(d)<1.0e60)sprintf(str,"%.0f",d);
-			else if (fabs(d)<1.0e-6 || fabs(d)>1.0e9)			sprintf(str,"%e",d);
-			else												sprintf(str,"%f",d);
-		}
+		end=str;
+		if (d<0) *end++='-',d=-d;
+		len=grisu2(d,digits,&K);
+		end=print_digits(end,digits,len,K);
 	}
+	*end=0;
+	return end-str;
+}
+
+/* Reserves only what is written, so a buffer of cJSON_PrintedLength()+1 bytes is never grown. */
+static char *print_number(cJSON *item,printbuffer *p)
+{
+	char buf[32],*str;int len=format_number(item,buf);
+	if (p)	str=ensure(p,len+1);
+	else	str=(char*)cJSON_malloc(len+1);
+	if (str) memcpy(str,buf,len+1);
 	return str;
 }
 
@@ -187,22 +1432,30 @@ static unsigned parse_hex4(const char *str)
 	return h;
 }
 
-/* Parse the input text into an unescaped cstring, and populate item. */
+/* The closing quote of the string at str, 0 on failure; escaped tells whether the body has escapes. */
+static const char *string_close(const char *str,int *escaped,parse_context *ctx)
+{
+	const char *ptr=str+1;
+	*escaped=0;
+	if (peek(ctx,str)!='\"') return parse_fail(ctx,str,"expected string");	/* not a string! */
+	while ((ptr=scan_string(ptr,ctx->end))<ctx->end && *ptr=='\\' && peek(ctx,ptr+1)) ptr+=2,*escaped=1;	/* Skip escaped quotes. */
+	if (peek(ctx,ptr)!='\"') return parse_fail(ctx,str,"unterminated string");
+	return ptr;
+}
+
+/* Unescape the string body from ptr to close into out, which may be ptr itself: escapes only shrink. Returns the end of
+   the output, which is not NUL-terminated. */
 static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
-static const char *parse_string(cJSON *item,const char *str)
+static char *unescape_string(const char *ptr,const char *close,char *out)
 {
-	const char *ptr=str+1;char *ptr2;char *out;int len=0;unsigned uc,uc2;
-	if (*str!='\"') {ep=str;return 0;}	/* not a string! */
-	
-	while (*ptr!='\"' && *ptr && ++len) if (*ptr++ == '\\') ptr++;	/* Skip escaped quotes. */
-	
-	out=(char*)cJSON_malloc(len+1);	/* This is how long we need for the string, roughly. */
-	if (!out) return 0;
-	
-	ptr=str+1;ptr2=out;
-	while (*ptr!='\"' && *ptr)
+	const char *run;char *ptr2=out;size_t len;unsigned uc,uc2;
+	while (ptr<close)
 	{
-		if (*ptr!='\\') *ptr2++=*ptr++;
+		if (*ptr!='\\')	/* copy up to the next escape in one go. */
+		{
+			if (!(run=(const char*)memchr(ptr,'\\',close-ptr))) run=close;
+			memmove(ptr2,ptr,run-ptr);ptr2+=run-ptr;ptr=run;
+		}
 		else
 		{
 			ptr++;
@@ -214,13 +1467,14 @@ static const char *parse_string(cJSON *item,const char *str)
 				case 'r': *ptr2++='\r';	break;
 				case 't': *ptr2++='\t';	break;
 				case 'u':	 /* transcode utf16 to utf8. */
+					if (close-ptr<5) {ptr=close-1;break;}	/* truncated escape. */
 					uc=parse_hex4(ptr+1);ptr+=4;	/* get the unicode char. */
 
 					if ((uc>=0xDC00 && uc<=0xDFFF) || uc==0)	break;	/* check for invalid.	*/
 
 					if (uc>=0xD800 && uc<=0xDBFF)	/* UTF16 surrogate pairs.	*/
 					{
-						if (ptr[1]!='\\' || ptr[2]!='u')	break;	/* missing second-half of surrogate.	*/
+						if (close-ptr<7 || ptr[1]!='\\' || ptr[2]!='u')	break;	/* missing second-half of surrogate.	*/
 						uc2=parse_hex4(ptr+3);ptr+=6;
 						if (uc2<0xDC00 || uc2>0xDFFF)		break;	/* invalid second-half of surrogate.	*/
 						uc=0x10000 + (((uc&0x3FF)<<10) | (uc2&0x3FF));
@@ -241,100 +1495,160 @@ static const char *parse_string(cJSON *item,const char *str)
 			ptr++;
 		}
 	}
-	*ptr2=0;
-	if (*ptr=='\"') ptr++;
+	return ptr2;
+}
+
+/* Parse the input text into an unescaped cstring, and populate item. */
+static const char *parse_string(cJSON *item,const char *str,size_t *length,parse_context *ctx)
+{
+	const char *close;char *out,*end;size_t len;int escaped;
+	if (!(close=string_close(str,&escaped,ctx))) return 0;
+
+	len=close-(str+1);	/* escapes only shrink. */
+	if (ctx->insitu) out=(char*)str+1;	/* unescape in place, the NUL lands on the closing quote at the latest. */
+	else if (!(out=(char*)alloc_malloc(ctx->allocator,len+1))) return parse_fail(ctx,str,"out of memory");
+
+	if (escaped) end=unescape_string(str+1,close,out);
+	else {if (!ctx->insitu) memcpy(out,str+1,len);end=out+len;}
+	*end=0;
+	if (length) *length=end-out;
 	item->valuestring=out;
-	item->type=cJSON_String;
-	return ptr;
+	item->type=ctx->insitu?cJSON_String|cJSON_ValueIsConst:cJSON_String;
+	return close+1;
+}
+
+/* The character after the backslash for each control character, 'u' for \u00XX. '"' and '\\' escape as themselves. */
+static const char escape_char[32]={'u','u','u','u','u','u','u','u','b','t','n','u','f','r','u','u',
+	'u','u','u','u','u','u','u','u','u','u','u','u','u','u','u','u'};
+static const char hex_digits[]="0123456789abcdef";
+
+/* Bytes the escapes between p and end add to the text. */
+static size_t escape_extra(const char *p,const char *end)
+{
+	size_t extra=0;unsigned char c;
+	while ((p=scan_escape(p,end))<end) {c=(unsigned char)*p++;extra+=(c<32 && escape_char[c]=='u')?5:1;}
+	return extra;
 }
 
-/* Render the cstring provided to an escaped version that can be printed. */
+/* Render the cstring provided to an escaped version that can be printed. Runs of safe bytes are copied whole. */
 static char *print_string_ptr(const char *str,printbuffer *p)
 {
-	const char *ptr;char *ptr2,*out;int len=0,flag=0;unsigned char token;
-	
-	for (ptr=str;*ptr;ptr++) flag|=((*ptr>0 && *ptr<32)||(*ptr=='\"')||(*ptr=='\\'))?1:0;
-	if (!flag)
-	{
-		len=ptr-str;
-		if (p) out=ensure(p,len+3);
-		else		out=(char*)cJSON_malloc(len+3);
-		if (!out) return 0;
-		ptr2=out;*ptr2++='\"';
-		strcpy(ptr2,str);
-		ptr2[len]='\"';
-		ptr2[len+1]=0;
-		return out;
-	}
-	
-	if (!str)
-	{
-		if (p)	out=ensure(p,3);
-		else	out=(char*)cJSON_malloc(3);
-		if (!out) return 0;
-		strcpy(out,"\"\"");
-		return out;
-	}
-	ptr=str;while ((token=*ptr) && ++len) {if (strchr("\"\\\b\f\n\r\t",token)) len++; else if (token<32) len+=5;ptr++;}
-	
-	if (p)	out=ensure(p,len+3);
+	const char *end,*run;char *ptr2,*out;size_t len,extra;unsigned char c;
+	if (!str) str="";
+	end=str+strlen(str);
+	extra=escape_extra(str,end);
+	len=(end-str)+extra;
+	if (len>INT_MAX-3) return 0;
+	if (p)	out=ensure(p,(int)len+3);
 	else	out=(char*)cJSON_malloc(len+3);
 	if (!out) return 0;
 
-	ptr2=out;ptr=str;
-	*ptr2++='\"';
-	while (*ptr)
+	ptr2=out;*ptr2++='\"';
+	if (!extra) {memcpy(ptr2,str,end-str);ptr2+=end-str;}
+	else for (;;)
 	{
-		if ((unsigned char)*ptr>31 && *ptr!='\"' && *ptr!='\\') *ptr2++=*ptr++;
-		else
-		{
-			*ptr2++='\\';
-			switch (token=*ptr++)
-			{
-				case '\\':	*ptr2++='\\';	break;
-				case '\"':	*ptr2++='\"';	break;
-				case '\b':	*ptr2++='b';	break;
-				case '\f':	*ptr2++='f';	break;
-				case '\n':	*ptr2++='n';	break;
-				case '\r':	*ptr2++='r';	break;
-				case '\t':	*ptr2++='t';	break;
-				default: sprintf(ptr2,"u%04x",token);ptr2+=5;	break;	/* escape and print */
-			}
-		}
+		run=scan_escape(str,end);
+		memcpy(ptr2,str,run-str);ptr2+=run-str;
+		if (run==end) break;
+		c=(unsigned char)*run;str=run+1;
+		*ptr2++='\\';
+		if (c>=32)						*ptr2++=c;
+		else if (escape_char[c]!='u')	*ptr2++=escape_char[c];
+		else {*ptr2++='u';*ptr2++='0';*ptr2++='0';*ptr2++=hex_digits[c>>4];*ptr2++=hex_digits[c&15];}
 	}
-	*ptr2++='\"';*ptr2++=0;
+	*ptr2++='\"';*ptr2=0;
 	return out;
 }
 /* Invote print_string_ptr (which is useful) on an item. */
 static char *print_string(cJSON *item,printbuffer *p)	{return print_string_ptr(item->valuestring,p);}
 
 /* Predeclare these prototypes. */
-static const char *parse_value(cJSON *item,const char *value);
+static const char *parse_value(cJSON *item,const char *value,parse_context *ctx);
 static char *print_value(cJSON *item,int depth,int fmt,printbuffer *p);
-static const char *parse_array(cJSON *item,const char *value);
+static const char *parse_array(cJSON *item,const char *value,parse_context *ctx);
 static char *print_array(cJSON *item,int depth,int fmt,printbuffer *p);
-static const char *parse_object(cJSON *item,const char *value);
+static const char *parse_object(cJSON *item,const char *value,parse_context *ctx);
 static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p);
 
 /* Utility to jump whitespace and cr/lf */
-static const char *skip(const char *in) {while (in && *in && (unsigned char)*in<=32) in++; return in;}
+static const char *skip(const char *in,const parse_context *ctx) {if (in && in<ctx->end && (unsigned char)(*in-1)<32) in=skip_ws(in+1,ctx->end); return in;}
 
-/* Parse an object - create a new root, and populate. */
-cJSON *cJSON_ParseWithOpts(const char *value,const char **return_parse_end,int require_null_terminated)
+/* Parse an object - create a new root, and populate. Without ctx->end the input is NUL-terminated. */
+static cJSON *parse_root(const char *value,const char **return_parse_end,int require_null_terminated,parse_context *ctx)
 {
 	const char *end=0;
-	cJSON *c=cJSON_New_Item();
-	ep=0;
-	if (!c) return 0;       /* memory fail */
+	cJSON *c;
+	if (!ctx->end && value) ctx->end=value+strlen(value);
+	if (!(c=alloc_item(ctx->allocator))) {parse_fail(ctx,value,"out of memory");return 0;}
 
-	end=parse_value(c,skip(value));
-	if (!end)	{cJSON_Delete(c);return 0;}	/* parse failure. ep is set. */
+	end=parse_value(c,skip(value,ctx),ctx);
+	if (!end)	{cJSON_DeleteWithAllocator(c,ctx->allocator);return 0;}	/* parse failure. ctx->error is set. */
 
 	/* if we require null-terminated JSON without appended garbage, skip and then check for a null terminator */
-	if (require_null_terminated) {end=skip(end);if (*end) {cJSON_Delete(c);ep=end;return 0;}}
+	if (require_null_terminated) {end=skip(end,ctx);if (peek(ctx,end)) {cJSON_DeleteWithAllocator(c,ctx->allocator);parse_fail(ctx,end,"unexpected data after value");return 0;}}
 	if (return_parse_end) *return_parse_end=end;
 	return c;
 }
+/* Only the original entry points publish the failure through the global ep. */
+cJSON *cJSON_ParseWithOpts(const char *value,const char **return_parse_end,int require_null_terminated)
+{
+	parse_context ctx={0};
+	cJSON *c=parse_root(value,return_parse_end,require_null_terminated,&ctx);
+	ep=ctx.error;
+	return c;
+}
+cJSON *cJSON_ParseWithFlags(const char *value,int flags)
+{
+	parse_context ctx={0};
+	ctx.flags=flags;
+	return parse_root(value,0,0,&ctx);
+}
+cJSON *cJSON_ParseWithAllocator(const char *value,int flags,const cJSON_Allocator *allocator)
+{
+	parse_context ctx={0};
+	ctx.flags=flags;ctx.allocator=allocator;
+	return parse_root(value,0,0,&ctx);
+}
+/* Fill error from the failure in ctx. It is located only now, the success path does not track lines. */
+static void locate_error(const char *value,const parse_context *ctx,cJSON_Error *error)
+{
+	const char *p;
+	error->reason=ctx->reason;
+	error->offset=ctx->error?(size_t)(ctx->error-value):0;
+	error->line=1;error->column=1;
+	for (p=value;p<value+error->offset;p++) if (*p=='\n') error->line++,error->column=1; else error->column++;
+}
+static cJSON *parse_with_error(const char *value,const char *end,int flags,const cJSON_Allocator *allocator,cJSON_Error *error,int insitu)
+{
+	parse_context ctx={0};cJSON *c;
+	if (!value) {if (error) {memset(error,0,sizeof(cJSON_Error));error->reason="no input";}return 0;}
+	ctx.flags=flags;ctx.allocator=allocator;ctx.end=end;ctx.insitu=insitu;
+	c=parse_root(value,0,(flags&cJSON_ParseRequireNullTerminated)!=0,&ctx);
+	if (c || !error) return c;
+	locate_error(value,&ctx,error);
+	return 0;
+}
+cJSON *cJSON_ParseWithError(const char *value,int flags,const cJSON_Allocator *allocator,cJSON_Error *error)
+{
+	return parse_with_error(value,0,flags,allocator,error,0);
+}
+cJSON *cJSON_ParseWithLength(const char *value,size_t length)
+{
+	return value?parse_with_error(value,value+length,0,0,0,0):0;
+}
+cJSON *cJSON_ParseWithLengthError(const char *value,size_t length,int flags,const cJSON_Allocator *allocator,cJSON_Error *error)
+{
+	return parse_with_error(value,value?value+length:0,flags,allocator,error,0);
+}
+cJSON *cJSON_ParseInSitu(char *value,size_t length,int flags,const cJSON_Allocator *allocator,cJSON_Error *error)
+{
+	return parse_with_error(value,value?value+length:0,flags,allocator,error,1);
+}
+cJSON *cJSON_ParseInArena(const char *value,int flags,cJSON_Arena *arena)
+{
+	if (!arena) return 0;
+	return cJSON_ParseWithAllocator(value,flags,cJSON_ArenaAllocator(arena));
+}
 /* Default options for cJSON_Parse */
 cJSON *cJSON_Parse(const char *value) {return cJSON_ParseWithOpts(value,0,0);}
 
@@ -344,35 +1658,225 @@ char *cJSON_PrintUnformatted(cJSON *item)	{return print_value(item,0,0,0);}
 
 char *cJSON_PrintBuffered(cJSON *item,int prebuffer,int fmt)
 {
-	printbuffer p;
+	printbuffer p={0};size_t len;
+	if (prebuffer<=0)	/* size it exactly */
+	{
+		if ((len=cJSON_PrintedLength(item,fmt))==(size_t)-1 || len>=INT_MAX) return 0;
+		prebuffer=(int)len+1;
+	}
 	p.buffer=(char*)cJSON_malloc(prebuffer);
 	p.length=prebuffer;
 	p.offset=0;
+	p.allocator=0;
 	return print_value(item,0,fmt,&p);
 	return p.buffer;
 }
 
+char *cJSON_PrintWithAllocator(cJSON *item,int fmt,const cJSON_Allocator *allocator)
+{
+	printbuffer p={0};
+	if (allocator && !allocator->free_fn) return 0;
+	p.allocator=allocator;
+	p.length=256;
+	p.offset=0;
+	if (!(p.buffer=(char*)alloc_malloc(allocator,p.length))) return 0;
+	return print_value(item,0,fmt,&p);
+}
+
+static char *fixed_size(void *ctx,char *buffer,size_t size) {(void)ctx;(void)buffer;(void)size;return 0;}
+
+/* Sink filling a fixed buffer with as much of the text as fits, counting all of it. */
+typedef struct {char *buffer;size_t size;size_t len;} prefix_sink;
+static int copy_prefix(void *ctx,const char *data,size_t len)
+{
+	prefix_sink *s=(prefix_sink*)ctx;
+	if (s->len+1<s->size) memcpy(s->buffer+s->len,data,s->len+len<s->size?len:s->size-1-s->len);
+	s->len+=len;
+	return 1;
+}
+
+size_t cJSON_PrintToResizable(cJSON *item,int fmt,char *buffer,size_t size,char *(*resize)(void *ctx,char *buffer,size_t size),void *ctx)
+{
+	printbuffer p={0};
+	if (!buffer || !size || size>INT_MAX) return (size_t)-1;
+	p.buffer=buffer;p.length=(int)size;
+	p.resize=resize?resize:fixed_size;p.resize_ctx=ctx;
+	if (!print_value(item,0,fmt,&p) || !p.buffer) return (size_t)-1;
+	return update(&p);
+}
+
+size_t cJSON_PrintToBuffer(cJSON *item,char *buffer,size_t size,int fmt)
+{
+	cJSON_Sink sink;prefix_sink prefix;size_t len;
+	if (size && (len=cJSON_PrintToResizable(item,fmt,buffer,size,0,0))!=(size_t)-1) return len;
+	/* ensure() reserves more than it uses, so the text may still fit: go through a sink */
+	prefix.buffer=buffer;prefix.size=size;prefix.len=0;
+	sink.write=copy_prefix;sink.ctx=&prefix;
+	if ((len=cJSON_PrintToSink(item,fmt,&sink,0))!=(size_t)-1 && size) buffer[len<size?len:size-1]=0;
+	return len;
+}
+
+size_t cJSON_PrintToSink(cJSON *item,int fmt,const cJSON_Sink *sink,size_t chunk)
+{
+	printbuffer p={0};size_t len;
+	if (chunk>INT_MAX/2) return (size_t)-1;
+	p.length=chunk?(int)chunk:4096;p.sink=sink;
+	if (!(p.buffer=(char*)cJSON_malloc(p.length))) return (size_t)-1;
+	if (!print_value(item,0,fmt,&p))	{if (p.buffer) cJSON_free(p.buffer);return (size_t)-1;}
+	len=update(&p);
+	if (len && !sink->write(sink->ctx,p.buffer,len)) len=(size_t)-1;
+	else len+=p.written;
+	cJSON_free(p.buffer);
+	return len;
+}
+
+
+/* Just past the array or object at p, found by matching brackets outside strings. Nothing else is checked. */
+static const char *skip_container(const char *p,parse_context *ctx)
+{
+	const char *start=p;int depth=0;
+	for (;;)
+	{
+		if ((p=scan_structural(p,ctx->end))>=ctx->end || !*p) return parse_fail(ctx,start,"unexpected end of input");
+		if (*p=='\"')
+		{
+			while ((p=scan_string(p+1,ctx->end))<ctx->end && *p=='\\' && peek(ctx,p+1)) p++;
+			if (peek(ctx,p)!='\"') return parse_fail(ctx,p,"unterminated string");
+		}
+		else if ((*p|0x20)=='{') depth++;
+		else if (!--depth) return p+1;
+		p++;
+	}
+}
+
+/* Keep a nested array or object unparsed for cJSON_Expand: valuestring points at its text, valueint64 holds the length
+   and valueint the parse flags. */
+static const char *parse_lazy(cJSON *item,const char *value,parse_context *ctx)
+{
+	const char *end=skip_container(value,ctx);
+	if (!end) return 0;
+	item->type=(*value=='['?cJSON_Array:cJSON_Object)|cJSON_Lazy|cJSON_ValueIsConst;
+	item->valuestring=(char*)value;item->valueint64=end-value;item->valueint=ctx->flags;
+	return end;
+}
+
+int cJSON_Expand(cJSON *item,const cJSON_Allocator *allocator,cJSON_Error *error)
+{
+	cJSON *c;
+	if (!item || !(item->type&cJSON_Lazy)) return 1;
+	if (item->type&cJSON_IsReference) {if (error) {memset(error,0,sizeof(cJSON_Error));error->reason="reference to an unexpanded item";}return 0;}
+	c=parse_with_error(item->valuestring,item->valuestring+item->valueint64,item->valueint,allocator,error,0);
+	if (!c) return 0;
+	/* take over the children of the parsed copy, keep the key. */
+	item->type=c->type|(item->type&(cJSON_StringIsConst|cJSON_CaseSensitive|cJSON_Indexed));
+	item->child=c->child;item->tail=c->tail;item->index=c->index;
+	item->valuestring=0;item->valueint=0;item->valueint64=0;
+	c->child=c->tail=0;c->index=0;
+	cJSON_DeleteWithAllocator(c,allocator);
+	return 1;
+}
+
+/* Framer states: between values, at the first byte of one (after cJSON_FrameBegin), in a string, after a backslash in a
+   string, in a number or literal. */
+enum {frame_between,frame_start,frame_string,frame_escape,frame_scalar};
+
+static int frame_scalar_char(char c)	{return (c>='0' && c<='9') || ((c|0x20)>='a' && (c|0x20)<='z') || c=='+' || c=='-' || c=='.';}
+
+int cJSON_Frame(cJSON_Framer *f,const char *data,size_t length,size_t *offset)
+{
+	const char *p=data,*end=data+length;
+	for (;;) switch (f->state)
+	{
+		case frame_escape:
+			if (p==end) {*offset=length;return cJSON_FrameMore;}
+			p++;f->state=frame_string;	/* fall through */
+		case frame_string:
+			while ((p=scan_string(p,end))<end && *p=='\\') if (++p<end) p++; else {f->state=frame_escape;break;}
+			if (p>=end) {*offset=length;return cJSON_FrameMore;}
+			if (!*p) {*offset=p-data;return cJSON_FrameError;}
+			p++;f->state=frame_between;
+			if (f->depth==f->array) {f->element=1;*offset=p-data;return cJSON_FrameEnd;}
+			break;
+		case frame_scalar:
+			while (p<end && frame_scalar_char(*p)) p++;
+			if (p==end) {*offset=length;return cJSON_FrameMore;}
+			f->state=frame_between;f->element=1;*offset=p-data;return cJSON_FrameEnd;
+		case frame_start:
+			if (p==end) {*offset=length;return cJSON_FrameMore;}
+			if (*p=='\"') f->state=frame_string;
+			else if ((*p|0x20)=='{') {f->depth++;f->state=frame_between;}
+			else if (frame_scalar_char(*p)) f->state=frame_scalar;
+			else {*offset=p-data;return cJSON_FrameError;}
+			p++;break;
+		default:
+			if (f->depth>f->array)
+			{
+				/* inside an array or object: match brackets outside strings. */
+				if ((p=scan_structural(p,end))>=end) {*offset=length;return cJSON_FrameMore;}
+				if (!*p) {*offset=p-data;return cJSON_FrameError;}
+				if (*p=='\"') f->state=frame_string;
+				else if ((*p|0x20)=='{') f->depth++;
+				else if (--f->depth==f->array) {f->element=1;*offset=++p-data;return cJSON_FrameEnd;}
+				p++;break;
+			}
+			if ((p=skip_ws(p,end))>=end) {*offset=length;return cJSON_FrameMore;}
+			if (f->array)	/* elements must be separated by exactly one ',', with none before the first or after the last. */
+			{
+				if (*p==',' ? f->element!=1 : *p==']' ? f->element==2 : f->element==1) {*offset=p-data;return cJSON_FrameError;}
+				if (*p==',') {f->element=2;p++;break;}
+				if (*p==']') {f->array=f->depth=0;p++;break;}
+			}
+			if (f->split && !f->array && *p=='[') {f->array=f->depth=1;f->element=0;p++;break;}
+			f->state=frame_start;*offset=p-data;return cJSON_FrameBegin;
+	}
+}
+
+int cJSON_FrameFinish(cJSON_Framer *f)
+{
+	if (f->state==frame_scalar) {f->state=frame_between;return cJSON_FrameEnd;}
+	return f->state==frame_between && !f->depth?cJSON_FrameMore:cJSON_FrameError;
+}
+
+/* The type of the literal at value, cJSON_NULL, cJSON_False or cJSON_True, or -1. It is 4 bytes long, false 5. */
+static int parse_literal(const char *value,const parse_context *ctx)
+{
+	size_t left=ctx->end-value;
+	if (left>=4 && !strncmp(value,"null",4))	return cJSON_NULL;
+	if (left>=5 && !strncmp(value,"false",5))	return cJSON_False;
+	if (left>=4 && !strncmp(value,"true",4))	return cJSON_True;
+	return -1;
+}
 
 /* Parser core - when encountering text, process appropriately. */
-static const char *parse_value(cJSON *item,const char *value)
+static const char *parse_value(cJSON *item,const char *value,parse_context *ctx)
 {
+	int type;char c;
 	if (!value)						return 0;	/* Fail on null. */
-	if (!strncmp(value,"null",4))	{ item->type=cJSON_NULL;  return value+4; }
-	if (!strncmp(value,"false",5))	{ item->type=cJSON_False; return value+5; }
-	if (!strncmp(value,"true",4))	{ item->type=cJSON_True; item->valueint=1;	return value+4; }
-	if (*value=='\"')				{ return parse_string(item,value); }
-	if (*value=='-' || (*value>='0' && *value<='9'))	{ return parse_number(item,value); }
-	if (*value=='[')				{ return parse_array(item,value); }
-	if (*value=='{')				{ return parse_object(item,value); }
-
-	ep=value;return 0;	/* failure. */
+	c=peek(ctx,value);
+	if ((type=parse_literal(value,ctx))>=0)	{ item->type=type; item->valueint=type==cJSON_True; return value+(type==cJSON_False?5:4); }
+	if (c=='\"')				{ return parse_string(item,value,0,ctx); }
+	if (c=='-' || (c>='0' && c<='9'))	{ return parse_number(item,value,ctx); }
+	if ((c=='[' || c=='{') && ctx->depth && (ctx->flags&cJSON_ParseLazy))	{ return parse_lazy(item,value,ctx); }
+	if (c=='[')				{ ctx->depth++;value=parse_array(item,value,ctx);ctx->depth--;return value; }
+	if (c=='{')				{ ctx->depth++;value=parse_object(item,value,ctx);ctx->depth--;return value; }
+
+	return parse_fail(ctx,value,c?"unexpected character":"unexpected end of input");	/* failure. */
 }
 
 /* Render a value to text. */
 static char *print_value(cJSON *item,int depth,int fmt,printbuffer *p)
 {
-	char *out=0;
+	char *out=0;size_t len;
 	if (!item) return 0;
+	if (item->type&cJSON_Lazy)	/* unexpanded: its text as it was parsed. */
+	{
+		len=(size_t)item->valueint64;
+		if (len>INT_MAX-1) return 0;
+		if (p)	out=ensure(p,(int)len+1);
+		else	out=(char*)cJSON_malloc(len+1);
+		if (out) {memcpy(out,item->valuestring,len);out[len]=0;}
+		return out;
+	}
 	if (p)
 	{
 		switch ((item->type)&255)
@@ -402,32 +1906,40 @@ static char *print_value(cJSON *item,int depth,int fmt,printbuffer *p)
 	return out;
 }
 
-/* Build an array from input text. */
-static const char *parse_array(cJSON *item,const char *value)
+/* The elements of an array, at least one: values separated by ',' and spacing. Returns past the last one and its spacing. */
+static const char *parse_elements(cJSON *item,const char *value,parse_context *ctx)
 {
 	cJSON *child;
-	if (*value!='[')	{ep=value;return 0;}	/* not an array! */
-
-	item->type=cJSON_Array;
-	value=skip(value+1);
-	if (*value==']') return value+1;	/* empty array. */
-
-	item->child=child=cJSON_New_Item();
-	if (!item->child) return 0;		 /* memory fail */
-	value=skip(parse_value(child,skip(value)));	/* skip any spacing, get the value. */
+	item->child=child=alloc_item(ctx->allocator);
+	if (!item->child) return parse_fail(ctx,value,"out of memory");
+	value=skip(parse_value(child,skip(value,ctx),ctx),ctx);	/* skip any spacing, get the value. */
 	if (!value) return 0;
 
-	while (*value==',')
+	while (peek(ctx,value)==',')
 	{
 		cJSON *new_item;
-		if (!(new_item=cJSON_New_Item())) return 0; 	/* memory fail */
+		if (!(new_item=alloc_item(ctx->allocator))) return parse_fail(ctx,value,"out of memory");
 		child->next=new_item;new_item->prev=child;child=new_item;
-		value=skip(parse_value(child,skip(value+1)));
+		value=skip(parse_value(child,skip(value+1,ctx),ctx),ctx);
 		if (!value) return 0;	/* memory fail */
 	}
 
-	if (*value==']') return value+1;	/* end of array */
-	ep=value;return 0;	/* malformed. */
+	item->tail=child;
+	return value;
+}
+
+/* Build an array from input text. */
+static const char *parse_array(cJSON *item,const char *value,parse_context *ctx)
+{
+	if (peek(ctx,value)!='[')	return parse_fail(ctx,value,"expected '['");	/* not an array! */
+
+	item->type=cJSON_Array;
+	value=skip(value+1,ctx);
+	if (peek(ctx,value)==']') return value+1;	/* empty array. */
+
+	if (!(value=parse_elements(item,value,ctx))) return 0;
+	if (peek(ctx,value)==']') return value+1;	/* end of array */
+	return parse_fail(ctx,value,peek(ctx,value)?"expected ',' or ']'":"unexpected end of input");	/* malformed. */
 }
 
 /* Render an array to text */
@@ -510,40 +2022,220 @@ static char *print_array(cJSON *item,int depth,int fmt,printbuffer *p)
 	return out;	
 }
 
-/* Build an object from the text. */
-static const char *parse_object(cJSON *item,const char *value)
+/* Keys parsed in situ point into the input: set before and after parsing the value, which assigns the type. */
+static int key_type(const parse_context *ctx)	{return ctx->insitu?cJSON_StringIsConst:0;}
+
+/* The members of an object, at least one: key, ':' and value, separated by ',' and spacing. Returns past the last one
+   and its spacing; count is their number. */
+static const char *parse_members(cJSON *item,const char *value,parse_context *ctx,int *count)
 {
 	cJSON *child;
-	if (*value!='{')	{ep=value;return 0;}	/* not an object! */
-	
-	item->type=cJSON_Object;
-	value=skip(value+1);
-	if (*value=='}') return value+1;	/* empty array. */
-	
-	item->child=child=cJSON_New_Item();
-	if (!item->child) return 0;
-	value=skip(parse_string(child,skip(value)));
+	item->child=child=alloc_item(ctx->allocator);
+	if (!item->child) return parse_fail(ctx,value,"out of memory");
+	value=skip(parse_string(child,skip(value,ctx),&child->stringlen,ctx),ctx);
 	if (!value) return 0;
-	child->string=child->valuestring;child->valuestring=0;
-	if (*value!=':') {ep=value;return 0;}	/* fail! */
-	value=skip(parse_value(child,skip(value+1)));	/* skip any spacing, get the value. */
+	child->string=child->valuestring;child->valuestring=0;child->type=key_type(ctx);
+	if (peek(ctx,value)!=':') return parse_fail(ctx,value,"expected ':'");	/* fail! */
+	value=skip(parse_value(child,skip(value+1,ctx),ctx),ctx);	/* skip any spacing, get the value. */
+	child->type|=key_type(ctx);
 	if (!value) return 0;
 	
-	while (*value==',')
+	while (peek(ctx,value)==',')
 	{
 		cJSON *new_item;
-		if (!(new_item=cJSON_New_Item()))	return 0; /* memory fail */
+		if (!(new_item=alloc_item(ctx->allocator)))	return parse_fail(ctx,value,"out of memory");
+		(*count)++;
 		child->next=new_item;new_item->prev=child;child=new_item;
-		value=skip(parse_string(child,skip(value+1)));
+		value=skip(parse_string(child,skip(value+1,ctx),&child->stringlen,ctx),ctx);
 		if (!value) return 0;
-		child->string=child->valuestring;child->valuestring=0;
-		if (*value!=':') {ep=value;return 0;}	/* fail! */
-		value=skip(parse_value(child,skip(value+1)));	/* skip any spacing, get the value. */
+		child->string=child->valuestring;child->valuestring=0;child->type=key_type(ctx);
+		if (peek(ctx,value)!=':') return parse_fail(ctx,value,"expected ':'");	/* fail! */
+		value=skip(parse_value(child,skip(value+1,ctx),ctx),ctx);	/* skip any spacing, get the value. */
+		child->type|=key_type(ctx);
 		if (!value) return 0;
 	}
 	
-	if (*value=='}') return value+1;	/* end of array */
-	ep=value;return 0;	/* malformed. */
+	item->tail=child;
+	return value;
+}
+
+/* Build an object from the text. */
+static const char *parse_object(cJSON *item,const char *value,parse_context *ctx)
+{
+	int count=1;
+	if (peek(ctx,value)!='{')	return parse_fail(ctx,value,"expected '{'");	/* not an object! */
+	
+	item->type=cJSON_Object;
+	value=skip(value+1,ctx);
+	if (peek(ctx,value)=='}') return value+1;	/* empty array. */
+	
+	if (!(value=parse_members(item,value,ctx,&count))) return 0;
+	if ((ctx->flags&cJSON_ParseIndexKeys) && count>=cJSON_IndexMinItems)
+	{
+		item->type|=cJSON_Indexed;
+		if (ctx->allocator) index_create(item,ctx->allocator);	/* lookups would index from the global hooks. */
+	}
+	if (ctx->flags&cJSON_ParseCaseSensitive) item->type|=cJSON_CaseSensitive;
+	if (peek(ctx,value)=='}') return value+1;	/* end of array */
+	return parse_fail(ctx,value,peek(ctx,value)?"expected ',' or '}'":"unexpected end of input");	/* malformed. */
+}
+
+/* Parsing in runs: the index pass only matches brackets and quotes, as skip_container does. Between two structural
+   characters at depth 1 there are no strings, so a ',' there separates elements. */
+size_t cJSON_SplitContainer(const char *value,size_t length,size_t every,size_t *splits,size_t max,size_t *end)
+{
+	parse_context ctx={0};const char *p,*q,*c;size_t n=0,next,from;int depth=0;
+	if (!value) return (size_t)-1;
+	ctx.end=value+length;
+	p=skip(value,&ctx);
+	if (peek(&ctx,p)!='[' && peek(&ctx,p)!='{') return (size_t)-1;
+	next=(size_t)(p-value)+(every<length?every:length);
+	for (;;)
+	{
+		q=scan_structural(p,ctx.end);
+		if (depth==1) for (from=(size_t)(p-value);n<max && (from=from>next?from:next)<(size_t)(q-value) && (c=(const char*)memchr(value+from,',',q-value-from));from=c-value+1)
+		{
+			splits[n++]=(size_t)(c-value);
+			next=(size_t)(c-value)+(every<length?every:length);
+		}
+		if (q>=ctx.end || !*q) return (size_t)-1;
+		if (*q=='\"')
+		{
+			while ((q=scan_string(q+1,ctx.end))<ctx.end && *q=='\\' && peek(&ctx,q+1)) q++;
+			if (peek(&ctx,q)!='\"') return (size_t)-1;
+		}
+		else if ((*q|0x20)=='{') depth++;
+		else if (!--depth) {if (end) *end=(size_t)(q+1-value);return n;}
+		p=q+1;
+	}
+}
+
+cJSON *cJSON_ParseRun(const char *value,size_t length,int type,int flags,const cJSON_Allocator *allocator,cJSON_Error *error)
+{
+	parse_context ctx={0};cJSON *c;const char *end;int count=1;
+	if (!value || (type!=cJSON_Array && type!=cJSON_Object)) {if (error) {memset(error,0,sizeof(cJSON_Error));error->reason="no input";}return 0;}
+	ctx.flags=flags;ctx.allocator=allocator;ctx.end=value+length;ctx.depth=1;	/* the elements are nested in the container. */
+	if (!(c=alloc_item(allocator))) end=parse_fail(&ctx,value,"out of memory");
+	else
+	{
+		c->type=type;
+		end=type==cJSON_Array?parse_elements(c,value,&ctx):parse_members(c,value,&ctx,&count);
+		if (end && peek(&ctx,end)) end=parse_fail(&ctx,end,type==cJSON_Array?"expected ',' or ']'":"expected ',' or '}'");
+		if (!end) {cJSON_DeleteWithAllocator(c,allocator);c=0;}
+	}
+	if (!c && error) locate_error(value,&ctx,error);
+	return c;
+}
+
+/* Event parser: the grammar of parse_value, parse_array and parse_object on the same tokenizer, reporting values to a
+   handler instead of building items. Strings with escapes are unescaped into buf, which grows to the longest one. */
+typedef struct {parse_context *ctx;const cJSON_Handler *h;char *buf;size_t size;} event_context;
+
+static const char *events_value(const char *value,event_context *ev);
+
+/* The handler refused the value at at. */
+static const char *events_stop(event_context *ev,const char *at)	{return parse_fail(ev->ctx,at,"stopped by handler");}
+
+/* The string at str, unescaped: its body in the input when it has no escapes, else copied into the scratch buffer. */
+static const char *events_string(const char *str,const char **out,size_t *length,event_context *ev)
+{
+	const char *close;char *buf;int escaped;
+	if (!(close=string_close(str,&escaped,ev->ctx))) return 0;
+	*out=str+1;*length=close-(str+1);
+	if (!escaped) return close+1;
+	if (ev->size<*length)
+	{
+		if (!(buf=(char*)cJSON_malloc(*length*2))) return parse_fail(ev->ctx,str,"out of memory");
+		if (ev->buf) cJSON_free(ev->buf);
+		ev->buf=buf;ev->size=*length*2;
+	}
+	*length=unescape_string(str+1,close,ev->buf)-ev->buf;*out=ev->buf;
+	return close+1;
+}
+
+static const char *events_array(const char *value,event_context *ev)
+{
+	const cJSON_Handler *h=ev->h;
+	if (h->start_array && !h->start_array(h->ctx)) return events_stop(ev,value);
+	value=skip(value+1,ev->ctx);
+	if (peek(ev->ctx,value)!=']')
+	{
+		value=skip(events_value(value,ev),ev->ctx);
+		while (value && peek(ev->ctx,value)==',') value=skip(events_value(skip(value+1,ev->ctx),ev),ev->ctx);
+		if (!value) return 0;
+		if (peek(ev->ctx,value)!=']') return parse_fail(ev->ctx,value,peek(ev->ctx,value)?"expected ',' or ']'":"unexpected end of input");
+	}
+	if (h->end_array && !h->end_array(h->ctx)) return events_stop(ev,value);
+	return value+1;
+}
+
+/* A key, its colon and its value, then any spacing. */
+static const char *events_member(const char *value,event_context *ev)
+{
+	const cJSON_Handler *h=ev->h;const char *str,*end;size_t len;
+	if (!(end=events_string(value,&str,&len,ev))) return 0;
+	if (h->key && !h->key(h->ctx,str,len)) return events_stop(ev,value);
+	end=skip(end,ev->ctx);
+	if (peek(ev->ctx,end)!=':') return parse_fail(ev->ctx,end,"expected ':'");
+	return skip(events_value(skip(end+1,ev->ctx),ev),ev->ctx);
+}
+
+static const char *events_object(const char *value,event_context *ev)
+{
+	const cJSON_Handler *h=ev->h;
+	if (h->start_object && !h->start_object(h->ctx)) return events_stop(ev,value);
+	value=skip(value+1,ev->ctx);
+	if (peek(ev->ctx,value)!='}')
+	{
+		value=events_member(value,ev);
+		while (value && peek(ev->ctx,value)==',') value=events_member(skip(value+1,ev->ctx),ev);
+		if (!value) return 0;
+		if (peek(ev->ctx,value)!='}') return parse_fail(ev->ctx,value,peek(ev->ctx,value)?"expected ',' or '}'":"unexpected end of input");
+	}
+	if (h->end_object && !h->end_object(h->ctx)) return events_stop(ev,value);
+	return value+1;
+}
+
+/* Numbers arrive in a scratch item, filled as parse_number fills the items of the tree. */
+static const char *events_value(const char *value,event_context *ev)
+{
+	const cJSON_Handler *h=ev->h;const char *str,*end;size_t len;int type;char c;cJSON num;
+	if (!value) return 0;
+	c=peek(ev->ctx,value);
+	if ((type=parse_literal(value,ev->ctx))>=0)
+	{
+		if (type==cJSON_NULL?h->null_value && !h->null_value(h->ctx):h->boolean && !h->boolean(h->ctx,type==cJSON_True)) return events_stop(ev,value);
+		return value+(type==cJSON_False?5:4);
+	}
+	if (c=='\"')
+	{
+		if (!(end=events_string(value,&str,&len,ev))) return 0;
+		if (h->string && !h->string(h->ctx,str,len)) return events_stop(ev,value);
+		return end;
+	}
+	if (c=='-' || (c>='0' && c<='9'))
+	{
+		memset(&num,0,sizeof(num));
+		if (!(end=parse_number(&num,value,ev->ctx))) return 0;
+		if (h->number && !h->number(h->ctx,&num)) return events_stop(ev,value);
+		return end;
+	}
+	if (c=='[') return events_array(value,ev);
+	if (c=='{') return events_object(value,ev);
+	return parse_fail(ev->ctx,value,c?"unexpected character":"unexpected end of input");
+}
+
+int cJSON_ParseEvents(const char *value,size_t length,int flags,const cJSON_Handler *handler,cJSON_Error *error)
+{
+	parse_context ctx={0};event_context ev={0};const char *end;
+	if (!value || !handler) {if (error) {memset(error,0,sizeof(cJSON_Error));error->reason="no input";}return 0;}
+	ctx.flags=flags;ctx.end=value+length;
+	ev.ctx=&ctx;ev.h=handler;
+	end=events_value(skip(value,&ctx),&ev);
+	if (end && (flags&cJSON_ParseRequireNullTerminated) && peek(&ctx,end=skip(end,&ctx))) parse_fail(&ctx,end,"unexpected data after value"),end=0;
+	if (ev.buf) cJSON_free(ev.buf);
+	if (!end && error) locate_error(value,&ctx,error);
+	return end!=0;
 }
 
 /* Render an object to text. */
@@ -559,8 +2251,9 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
 	/* Explicitly handle empty object case */
 	if (!numentries)
 	{
-		if (p) out=ensure(p,fmt?depth+4:3);
-		else	out=(char*)cJSON_malloc(fmt?depth+4:3);
+		len=fmt?(depth>1?depth+3:4):3;
+		if (p) out=ensure(p,len);
+		else	out=(char*)cJSON_malloc(len);
 		if (!out)	return 0;
 		ptr=out;*ptr++='{';
 		if (fmt) {*ptr++='\n';for (i=0;i<depth-1;i++) *ptr++='\t';}
@@ -657,36 +2350,96 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
 	return out;	
 }
 
+/* Length of the escaped string with its quotes, as print_string_ptr writes it. */
+static size_t string_length(const char *str)
+{
+	size_t len;
+	if (!str) return 2;
+	len=strlen(str);
+	return len+escape_extra(str,str+len)+2;
+}
+
+/* Length of the text print_value writes at depth, without printing it. */
+static size_t printed_length(cJSON *item,int depth,int fmt)
+{
+	char buf[32];size_t len,sub;cJSON *child;
+	if (item->type&cJSON_Lazy) return (size_t)item->valueint64;
+	switch (item->type&255)
+	{
+		case cJSON_NULL:	return 4;
+		case cJSON_False:	return 5;
+		case cJSON_True:	return 4;
+		case cJSON_Number:	return format_number(item,buf);
+		case cJSON_String:	return string_length(item->valuestring);
+		case cJSON_Array:
+			len=2;
+			for (child=item->child;child;child=child->next)
+			{
+				if ((sub=printed_length(child,depth+1,fmt))==(size_t)-1) return sub;
+				len+=sub+(child->next?(fmt?2:1):0);
+			}
+			return len;
+		case cJSON_Object:
+			if (!item->child) return fmt?(depth>1?depth+2:3):2;
+			len=fmt?2+depth:1;depth++;	/* "{\n" and the closing tabs */
+			for (child=item->child;child;child=child->next)
+			{
+				if ((sub=printed_length(child,depth,fmt))==(size_t)-1) return sub;
+				len+=string_length(child->string)+sub+1+(child->next?1:0)+(fmt?depth+2:0);
+			}
+			return len+1;
+	}
+	return (size_t)-1;
+}
+
+size_t cJSON_PrintedLength(cJSON *item,int fmt)	{return item?printed_length(item,0,fmt):(size_t)-1;}
+
 /* Get Array size/item / object item. */
 int    cJSON_GetArraySize(cJSON *array)							{cJSON *c=array->child;int i=0;while(c)i++,c=c->next;return i;}
 cJSON *cJSON_GetArrayItem(cJSON *array,int item)				{cJSON *c=array->child;  while (c && item>0) item--,c=c->next; return c;}
-cJSON *cJSON_GetObjectItem(cJSON *object,const char *string)	{cJSON *c=object->child; while (c && cJSON_strcasecmp(c->string,string)) c=c->next; return c;}
+cJSON *cJSON_GetObjectItem(cJSON *object,const char *string)	{cJSON *c;if (string) return find_key(object,string,strlen(string),(object->type&cJSON_CaseSensitive)!=0);
+	c=object->child; while (c && cJSON_strcasecmp(c->string,string)) c=c->next; return c;}
+cJSON *cJSON_GetObjectItemWithLength(cJSON *object,const char *string,size_t length)	{return find_key(object,string,length,(object->type&cJSON_CaseSensitive)!=0);}
+cJSON *cJSON_GetObjectItemCaseSensitive(cJSON *object,const char *string)	{return string?find_key(object,string,strlen(string),1):0;}
+
+void cJSON_IndexObject(cJSON *object)	{if ((object->type&255)==cJSON_Object) object->type|=cJSON_Indexed;}
 
 /* Utility for array list handling. */
 static void suffix_object(cJSON *prev,cJSON *item) {prev->next=item;item->prev=prev;}
+/* Last item of the chain. The tail hint is trusted unless the chain was extended behind our back. */
+static cJSON *last_child(cJSON *array)	{cJSON *c=array->tail;if (!c) c=array->child;while (c && c->next) c=c->next;return c;}
 /* Utility for handling references. */
-static cJSON *create_reference(cJSON *item) {cJSON *ref=cJSON_New_Item();if (!ref) return 0;memcpy(ref,item,sizeof(cJSON));ref->string=0;ref->type|=cJSON_IsReference;ref->next=ref->prev=0;return ref;}
+static cJSON *create_reference(cJSON *item,const cJSON_Allocator *a) {cJSON *ref=alloc_item(a);if (!ref) return 0;memcpy(ref,item,sizeof(cJSON));ref->string=0;ref->stringlen=0;ref->type|=cJSON_IsReference;ref->next=ref->prev=0;return ref;}
 
 /* Add item to array/object. */
-void   cJSON_AddItemToArray(cJSON *array, cJSON *item)						{cJSON *c=array->child;if (!item) return; if (!c) {array->child=item;} else {while (c && c->next) c=c->next; suffix_object(c,item);}}
-void   cJSON_AddItemToObject(cJSON *object,const char *string,cJSON *item)	{if (!item) return; if (item->string) cJSON_free(item->string);item->string=cJSON_strdup(string);cJSON_AddItemToArray(object,item);}
-void   cJSON_AddItemToObjectCS(cJSON *object,const char *string,cJSON *item)	{if (!item) return; if (!(item->type&cJSON_StringIsConst) && item->string) cJSON_free(item->string);item->string=(char*)string;item->type|=cJSON_StringIsConst;cJSON_AddItemToArray(object,item);}
-void	cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item)						{cJSON_AddItemToArray(array,create_reference(item));}
-void	cJSON_AddItemReferenceToObject(cJSON *object,const char *string,cJSON *item)	{cJSON_AddItemToObject(object,string,create_reference(item));}
-
-cJSON *cJSON_DetachItemFromArray(cJSON *array,int which)			{cJSON *c=array->child;while (c && which>0) c=c->next,which--;if (!c) return 0;
-	if (c->prev) c->prev->next=c->next;if (c->next) c->next->prev=c->prev;if (c==array->child) array->child=c->next;c->prev=c->next=0;return c;}
+void   cJSON_AddItemToArray(cJSON *array, cJSON *item)						{if (!item) return; if (!array->child) {array->child=item;} else {suffix_object(last_child(array),item);} array->tail=item;if (array->index) index_add(array->index,item);}
+void   cJSON_AddItemToObjectWithAllocator(cJSON *object,const char *string,cJSON *item,const cJSON_Allocator *a)	{if (!item) return; if (item->string && !(item->type&cJSON_StringIsConst)) alloc_free(a,item->string);item->type&=~cJSON_StringIsConst;
+	item->string=alloc_strdup(string,a);item->stringlen=strlen(string);cJSON_AddItemToArray(object,item);}
+void   cJSON_AddItemToObject(cJSON *object,const char *string,cJSON *item)	{cJSON_AddItemToObjectWithAllocator(object,string,item,0);}
+void   cJSON_AddItemToObjectCS(cJSON *object,const char *string,cJSON *item)	{if (!item) return; if (!(item->type&cJSON_StringIsConst) && item->string) cJSON_free(item->string);item->string=(char*)string;item->stringlen=strlen(string);item->type|=cJSON_StringIsConst;cJSON_AddItemToArray(object,item);}
+void	cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item)						{cJSON_AddItemToArray(array,create_reference(item,0));}
+void	cJSON_AddItemReferenceToObject(cJSON *object,const char *string,cJSON *item)	{cJSON_AddItemToObject(object,string,create_reference(item,0));}
+void	cJSON_AddItemReferenceToArrayWithAllocator(cJSON *array,cJSON *item,const cJSON_Allocator *a)						{cJSON_AddItemToArray(array,create_reference(item,a));}
+void	cJSON_AddItemReferenceToObjectWithAllocator(cJSON *object,const char *string,cJSON *item,const cJSON_Allocator *a)	{cJSON_AddItemToObjectWithAllocator(object,string,create_reference(item,a),a);}
+void	cJSON_IndexObjectWithAllocator(cJSON *object,const cJSON_Allocator *a)	{if ((object->type&255)!=cJSON_Object) return;object->type|=cJSON_Indexed;if (!object->index && !(object->type&cJSON_IsReference)) index_create(object,a);}
+
+static cJSON *detach_item(cJSON *array,cJSON *c)	{if (!c) return 0;if (array->index) index_remove(array->index,c);
+	if (c->prev) c->prev->next=c->next;if (c->next) c->next->prev=c->prev;if (c==array->child) array->child=c->next;if (c==array->tail) array->tail=c->prev;c->prev=c->next=0;return c;}
+cJSON *cJSON_DetachItemFromArray(cJSON *array,int which)			{return detach_item(array,cJSON_GetArrayItem(array,which));}
 void   cJSON_DeleteItemFromArray(cJSON *array,int which)			{cJSON_Delete(cJSON_DetachItemFromArray(array,which));}
-cJSON *cJSON_DetachItemFromObject(cJSON *object,const char *string) {int i=0;cJSON *c=object->child;while (c && cJSON_strcasecmp(c->string,string)) i++,c=c->next;if (c) return cJSON_DetachItemFromArray(object,i);return 0;}
+cJSON *cJSON_DetachItemFromObject(cJSON *object,const char *string) {return detach_item(object,cJSON_GetObjectItem(object,string));}
 void   cJSON_DeleteItemFromObject(cJSON *object,const char *string) {cJSON_Delete(cJSON_DetachItemFromObject(object,string));}
 
 /* Replace array/object items with new ones. */
 void   cJSON_InsertItemInArray(cJSON *array,int which,cJSON *newitem)		{cJSON *c=array->child;while (c && which>0) c=c->next,which--;if (!c) {cJSON_AddItemToArray(array,newitem);return;}
-	newitem->next=c;newitem->prev=c->prev;c->prev=newitem;if (c==array->child) array->child=newitem; else newitem->prev->next=newitem;}
-void   cJSON_ReplaceItemInArray(cJSON *array,int which,cJSON *newitem)		{cJSON *c=array->child;while (c && which>0) c=c->next,which--;if (!c) return;
+	newitem->next=c;newitem->prev=c->prev;c->prev=newitem;if (c==array->child) array->child=newitem; else newitem->prev->next=newitem;
+	if (array->index && array->index->slots) index_drop(array->index);}	/* ordering of duplicate keys may change. */
+static void replace_item(cJSON *array,cJSON *c,cJSON *newitem)		{if (!c) return;if (array->index) {index_remove(array->index,c);if (array->index->slots && newitem->string && *index_item_slot(array->index,newitem)) index_drop(array->index);}
 	newitem->next=c->next;newitem->prev=c->prev;if (newitem->next) newitem->next->prev=newitem;
-	if (c==array->child) array->child=newitem; else newitem->prev->next=newitem;c->next=c->prev=0;cJSON_Delete(c);}
-void   cJSON_ReplaceItemInObject(cJSON *object,const char *string,cJSON *newitem){int i=0;cJSON *c=object->child;while(c && cJSON_strcasecmp(c->string,string))i++,c=c->next;if(c){newitem->string=cJSON_strdup(string);cJSON_ReplaceItemInArray(object,i,newitem);}}
+	if (c==array->child) array->child=newitem; else newitem->prev->next=newitem;if (c==array->tail) array->tail=newitem;c->next=c->prev=0;cJSON_Delete(c);
+	if (array->index) index_add(array->index,newitem);}
+void   cJSON_ReplaceItemInArray(cJSON *array,int which,cJSON *newitem)		{replace_item(array,cJSON_GetArrayItem(array,which),newitem);}
+void   cJSON_ReplaceItemInObject(cJSON *object,const char *string,cJSON *newitem){cJSON *c=cJSON_GetObjectItem(object,string);if(c){newitem->string=cJSON_strdup(string);newitem->stringlen=strlen(string);replace_item(object,c,newitem);}}
 
 /* Create basic types: */
 cJSON *cJSON_CreateNull(void)					{cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_NULL;return item;}
@@ -694,15 +2447,27 @@ cJSON *cJSON_CreateTrue(void)					{cJSON *item=cJSON_New_Item();if(item)item->ty
 cJSON *cJSON_CreateFalse(void)					{cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_False;return item;}
 cJSON *cJSON_CreateBool(int b)					{cJSON *item=cJSON_New_Item();if(item)item->type=b?cJSON_True:cJSON_False;return item;}
 cJSON *cJSON_CreateNumber(double num)			{cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_Number;item->valuedouble=num;item->valueint=(int)num;}return item;}
+cJSON *cJSON_CreateInt64(int64_t num)			{cJSON *item=cJSON_CreateNumber((double)num);if(item){item->type|=cJSON_Int64;item->valueint64=num;}return item;}
+cJSON *cJSON_CreateUint64(uint64_t num)			{cJSON *item=num<=INT64_MAX?cJSON_CreateInt64((int64_t)num):cJSON_CreateNumber((double)num);if(item && num>INT64_MAX){item->type|=cJSON_Int64|cJSON_Uint64;item->valueint64=(int64_t)(num-INT64_MAX-1)+INT64_MIN;}return item;}
 cJSON *cJSON_CreateString(const char *string)	{cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_String;item->valuestring=cJSON_strdup(string);}return item;}
 cJSON *cJSON_CreateArray(void)					{cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_Array;return item;}
 cJSON *cJSON_CreateObject(void)					{cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_Object;return item;}
 
+cJSON *cJSON_CreateWithAllocator(int type,const cJSON_Allocator *a)	{cJSON *item=alloc_item(a);if(item){item->type=type;if(type==cJSON_True)item->valueint=1;}return item;}
+cJSON *cJSON_CreateNumberWithAllocator(double num,const cJSON_Allocator *a)	{cJSON *item=alloc_item(a);if(item){item->type=cJSON_Number;item->valuedouble=num;item->valueint=(int)num;}return item;}
+cJSON *cJSON_CreateStringWithAllocator(const char *string,const cJSON_Allocator *a)	{cJSON *item=alloc_item(a);if(item){item->type=cJSON_String;item->valuestring=alloc_strdup(string,a);}return item;}
+cJSON *cJSON_CreateStringWithLength(const char *string,size_t length,const cJSON_Allocator *a)
+{
+	cJSON *item=alloc_item(a);if (!item) return 0;
+	if (!(item->valuestring=(char*)alloc_malloc(a,length+1))) {alloc_free(a,item);return 0;}
+	memcpy(item->valuestring,string,length);item->valuestring[length]=0;item->type=cJSON_String;return item;
+}
+
 /* Create Arrays: */
-cJSON *cJSON_CreateIntArray(const int *numbers,int count)		{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
-cJSON *cJSON_CreateFloatArray(const float *numbers,int count)	{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
-cJSON *cJSON_CreateDoubleArray(const double *numbers,int count)	{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
-cJSON *cJSON_CreateStringArray(const char **strings,int count)	{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateString(strings[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
+cJSON *cJSON_CreateIntArray(const int *numbers,int count)		{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}if(a)a->tail=p;return a;}
+cJSON *cJSON_CreateFloatArray(const float *numbers,int count)	{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}if(a)a->tail=p;return a;}
+cJSON *cJSON_CreateDoubleArray(const double *numbers,int count)	{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}if(a)a->tail=p;return a;}
+cJSON *cJSON_CreateStringArray(const char **strings,int count)	{int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateString(strings[i]);if(!i)a->child=n;else suffix_object(p,n);p=n;}if(a)a->tail=p;return a;}
 
 /* Duplication */
 cJSON *cJSON_Duplicate(cJSON *item,int recurse)
@@ -710,13 +2475,21 @@ cJSON *cJSON_Duplicate(cJSON *item,int recurse)
 	cJSON *newitem,*cptr,*nptr=0,*newchild;
 	/* Bail on bad ptr */
 	if (!item) return 0;
+	if ((item->type&cJSON_Lazy) && recurse)	/* the copy owns all its nodes: parse the text fully. */
+	{
+		newitem=parse_with_error(item->valuestring,item->valuestring+item->valueint64,item->valueint&~cJSON_ParseLazy,0,0,0);
+		if (!newitem) return 0;
+		if (item->string)	{newitem->string=cJSON_strdup(item->string);			if (!newitem->string)		{cJSON_Delete(newitem);return 0;}newitem->stringlen=item->stringlen;}
+		return newitem;
+	}
 	/* Create new item */
 	newitem=cJSON_New_Item();
 	if (!newitem) return 0;
 	/* Copy over all vars */
-	newitem->type=item->type&(~cJSON_IsReference),newitem->valueint=item->valueint,newitem->valuedouble=item->valuedouble;
-	if (item->valuestring)	{newitem->valuestring=cJSON_strdup(item->valuestring);	if (!newitem->valuestring)	{cJSON_Delete(newitem);return 0;}}
-	if (item->string)		{newitem->string=cJSON_strdup(item->string);			if (!newitem->string)		{cJSON_Delete(newitem);return 0;}}
+	if (item->type&cJSON_Lazy) {newitem->type=item->type&255;}	/* the empty container. */
+	else newitem->type=item->type&~(cJSON_IsReference|cJSON_StringIsConst|cJSON_ValueIsConst),newitem->valueint=item->valueint,newitem->valuedouble=item->valuedouble,newitem->valueint64=item->valueint64;
+	if (item->valuestring && !(item->type&cJSON_Lazy))	{newitem->valuestring=cJSON_strdup(item->valuestring);	if (!newitem->valuestring)	{cJSON_Delete(newitem);return 0;}}
+	if (item->string)		{newitem->string=cJSON_strdup(item->string);			if (!newitem->string)		{cJSON_Delete(newitem);return 0;}newitem->stringlen=item->stringlen;}
 	/* If non-recursive, then we're done! */
 	if (!recurse) return newitem;
 	/* Walk the ->next chain for the child. */
@@ -729,6 +2502,7 @@ cJSON *cJSON_Duplicate(cJSON *item,int recurse)
 		else		{newitem->child=newchild;nptr=newchild;}					/* Set newitem->child and move to it */
 		cptr=cptr->next;
 	}
+	newitem->tail=nptr;
 	return newitem;
 }
 
@@ -23,6 +23,9 @@
 #ifndef cJSON__h
 #define cJSON__h
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -39,6 +42,20 @@ extern "C"
 	
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_Indexed 1024			/* Object keeps a hash index of its keys, built on the first lookup. */
+#define cJSON_CaseSensitive 2048	/* Object matches keys case-sensitively in GetObjectItem and the other by-name calls. */
+#define cJSON_Int64 4096			/* Number is an integer held exactly in valueint64. Clear it when assigning valuedouble by hand. */
+#define cJSON_Uint64 8192			/* With cJSON_Int64: the integer is above INT64_MAX, valueint64 holds it as (int64_t)(value-2^64). */
+#define cJSON_ValueIsConst 16384	/* valuestring is not owned by the item (cJSON_ParseInSitu): it is never freed. */
+#define cJSON_Lazy 32768			/* Array or object not parsed yet (cJSON_ParseLazy): it has no children until cJSON_Expand. */
+
+/* Flags for cJSON_ParseWithFlags. */
+#define cJSON_ParseIndexKeys 1		/* Mark objects with at least cJSON_IndexMinItems keys as cJSON_Indexed. */
+#define cJSON_ParseCaseSensitive 2	/* Mark all objects as cJSON_CaseSensitive. */
+#define cJSON_ParseRequireNullTerminated 4	/* Fail on anything but whitespace after the value. */
+#define cJSON_ParseLazy 8			/* Parse only the top level: nested arrays and objects are skipped by matching brackets and
+									   marked cJSON_Lazy. Their text stays in the input, which must outlive the tree. */
+#define cJSON_IndexMinItems 16
 
 /* The cJSON structure: */
 typedef struct cJSON {
@@ -50,8 +67,13 @@ typedef struct cJSON {
 	char *valuestring;			/* The item's string, if type==cJSON_String */
 	int valueint;				/* The item's number, if type==cJSON_Number */
 	double valuedouble;			/* The item's number, if type==cJSON_Number */
+	int64_t valueint64;			/* The item's exact integer, if type has cJSON_Int64 */
 
 	char *string;				/* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
+	size_t stringlen;			/* Length of string, kept by the API (0 if string was assigned by hand). */
+
+	struct cJSON *tail;			/* Last item of the child chain, kept by the API so appends are O(1). Set to 0 after editing the chain by hand. */
+	struct cJSON_Index *index;	/* Key index of a cJSON_Indexed object, maintained by the API. Edit indexed objects through the API only. */
 } cJSON;
 
 typedef struct cJSON_Hooks {
@@ -62,6 +84,15 @@ typedef struct cJSON_Hooks {
 /* Supply malloc, realloc and free functions to cJSON */
 extern void cJSON_InitHooks(cJSON_Hooks* hooks);
 
+/* Allocator passed to the *WithAllocator calls, in place of the global hooks (a 0 allocator selects the hooks).
+   Items of a tree must all come from the same allocator, which has to outlive the tree.
+   An allocator without free_fn releases its memory in bulk (like an arena): deleting is a no-op. */
+typedef struct cJSON_Allocator {
+	void *(*malloc_fn)(void *ctx,size_t sz);
+	void (*free_fn)(void *ctx,void *ptr);
+	void *ctx;
+} cJSON_Allocator;
+
 
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. Call cJSON_Delete when finished. */
 extern cJSON *cJSON_Parse(const char *value);
@@ -69,8 +100,11 @@ extern cJSON *cJSON_Parse(const char *value);
 extern char  *cJSON_Print(cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. Free the char* when finished. */
 extern char  *cJSON_PrintUnformatted(cJSON *item);
-/* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
+/* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation, 0 sizes it exactly with cJSON_PrintedLength. fmt=0 gives unformatted, =1 gives formatted */
 extern char *cJSON_PrintBuffered(cJSON *item,int prebuffer,int fmt);
+/* Length of the text cJSON_PrintBuffered would render, without the terminating NUL, or (size_t)-1 if item cannot be printed.
+   Walks the tree without writing: a buffer of length+1 bytes is printed into without growing. */
+extern size_t cJSON_PrintedLength(cJSON *item,int fmt);
 /* Delete a cJSON entity and all subentities. */
 extern void   cJSON_Delete(cJSON *c);
 
@@ -78,10 +112,17 @@ extern void   cJSON_Delete(cJSON *c);
 extern int	  cJSON_GetArraySize(cJSON *array);
 /* Retrieve item number "item" from array "array". Returns NULL if unsuccessful. */
 extern cJSON *cJSON_GetArrayItem(cJSON *array,int item);
-/* Get item "string" from object. Case insensitive. */
+/* Get item "string" from object. Case insensitive unless the object is cJSON_CaseSensitive. O(1) for cJSON_Indexed objects. */
 extern cJSON *cJSON_GetObjectItem(cJSON *object,const char *string);
+/* Same as GetObjectItem, for a key of the given length that need not be null terminated. */
+extern cJSON *cJSON_GetObjectItemWithLength(cJSON *object,const char *string,size_t length);
+/* Get item "string" from object, matching the key exactly. */
+extern cJSON *cJSON_GetObjectItemCaseSensitive(cJSON *object,const char *string);
+/* Opt the object in to hash-indexed key lookup. The index is built on the next lookup and kept up to date by the add/detach/replace calls. */
+extern void cJSON_IndexObject(cJSON *object);
 
-/* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
+/* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds.
+   Set by cJSON_Parse and cJSON_ParseWithOpts only, and shared by all threads: prefer cJSON_ParseWithError. */
 extern const char *cJSON_GetErrorPtr(void);
 	
 /* These calls create a cJSON item of the appropriate type. */
@@ -90,6 +131,9 @@ extern cJSON *cJSON_CreateTrue(void);
 extern cJSON *cJSON_CreateFalse(void);
 extern cJSON *cJSON_CreateBool(int b);
 extern cJSON *cJSON_CreateNumber(double num);
+/* Integers kept exact (cJSON_Int64), valuedouble holds the nearest double. */
+extern cJSON *cJSON_CreateInt64(int64_t num);
+extern cJSON *cJSON_CreateUint64(uint64_t num);
 extern cJSON *cJSON_CreateString(const char *string);
 extern cJSON *cJSON_CreateArray(void);
 extern cJSON *cJSON_CreateObject(void);
@@ -127,6 +171,125 @@ The item->next and ->prev pointers are always zero on return from Duplicate. */
 
 /* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
 extern cJSON *cJSON_ParseWithOpts(const char *value,const char **return_parse_end,int require_null_terminated);
+/* Parse with cJSON_Parse* flags. */
+extern cJSON *cJSON_ParseWithFlags(const char *value,int flags);
+
+/* Arena for parse trees: items and strings are carved out of large blocks and released all at once. */
+typedef struct cJSON_Arena cJSON_Arena;
+/* Create an arena allocating blocks of block_size bytes (0 for the default of 64k). */
+extern cJSON_Arena *cJSON_ArenaCreate(size_t block_size);
+/* Release everything allocated in the arena. The largest block is kept for reuse. */
+extern void cJSON_ArenaReset(cJSON_Arena *arena);
+extern void cJSON_ArenaDestroy(cJSON_Arena *arena);
+/* The arena as an allocator for the *WithAllocator calls. */
+extern const cJSON_Allocator *cJSON_ArenaAllocator(cJSON_Arena *arena);
+/* Parse into an arena. The tree must not be passed to cJSON_Delete: it is released by cJSON_ArenaReset/Destroy.
+   Items added to it must come from the arena too (the *WithAllocator calls). */
+extern cJSON *cJSON_ParseInArena(const char *value,int flags,cJSON_Arena *arena);
+
+/* Parse failure, reported per call. */
+typedef struct cJSON_Error {
+	size_t offset;				/* Byte offset of the failure in the input. */
+	int line, column;			/* 1-based line and byte column of the failure. */
+	const char *reason;			/* Static description, e.g. "expected ':'". */
+} cJSON_Error;
+/* Parse with cJSON_Parse* flags and allocator (0 for the global hooks). On failure fills error, if not 0. Thread-safe. */
+extern cJSON *cJSON_ParseWithError(const char *value,int flags,const cJSON_Allocator *allocator,cJSON_Error *error);
+/* Parse exactly length bytes of value, which need not be NUL-terminated; nothing past value+length is read.
+   A NUL byte inside the range ends the input, as it does for cJSON_Parse. */
+extern cJSON *cJSON_ParseWithLength(const char *value,size_t length);
+extern cJSON *cJSON_ParseWithLengthError(const char *value,size_t length,int flags,const cJSON_Allocator *allocator,cJSON_Error *error);
+/* Parse length bytes of value in place, without copying strings: they are unescaped inside value and NUL-terminated
+   where their closing quote was, and valuestring/string point into it (cJSON_ValueIsConst/cJSON_StringIsConst).
+   value must outlive the tree and is left modified, also on failure. */
+extern cJSON *cJSON_ParseInSitu(char *value,size_t length,int flags,const cJSON_Allocator *allocator,cJSON_Error *error);
+/* Parse the children of a cJSON_Lazy item, with the allocator of its tree; nested arrays and objects stay lazy.
+   Call it before reading or changing a lazy item: until then it looks empty to the other calls, and prints as its input text.
+   Its text is only checked now: on failure returns 0, fills error (offsets relative to the item's text) and leaves it lazy. */
+extern int cJSON_Expand(cJSON *item,const cJSON_Allocator *allocator,cJSON_Error *error);
+
+/* Framing of a stream of values arriving in chunks, e.g. from a socket: finds where each value begins and ends, without
+   parsing it, resuming across chunk boundaries. Values are separated by whitespace; with split set, the elements of a
+   top-level array are framed one by one instead of the array. Zero-initialize the framer, then call cJSON_Frame on each
+   chunk until it is consumed: it returns at the first event, and *offset is where it stopped in data. */
+typedef struct cJSON_Framer {
+	int split;					/* Frame the elements of top-level arrays. */
+	int array;					/* Inside a split array. */
+	int depth;					/* Open arrays and objects, the split array included. */
+	int element;				/* In a split array: 0 at its start, 1 after an element, 2 after a ','. */
+	int state;
+} cJSON_Framer;
+#define cJSON_FrameMore 0		/* The chunk is consumed. */
+#define cJSON_FrameBegin 1		/* A value begins at *offset. */
+#define cJSON_FrameEnd 2		/* A value ends just before *offset. */
+#define cJSON_FrameError 3		/* Not a value at *offset: a stray ',', ']' or '}', a missing ',' in a split array, or a NUL byte. */
+extern int cJSON_Frame(cJSON_Framer *f,const char *data,size_t length,size_t *offset);
+/* At the end of the stream: cJSON_FrameEnd if a number or literal in progress ends there, cJSON_FrameError if a value is
+   left open, else cJSON_FrameMore. */
+extern int cJSON_FrameFinish(cJSON_Framer *f);
+
+/* Parsing into events (SAX), without building a tree. Each callback gets ctx and returns 0 to stop the parse; callbacks
+   left 0 are skipped. Strings and keys are unescaped but not NUL-terminated, and only valid during the call: they point
+   into the input, or into a scratch buffer when they had escapes. A number arrives as the item the tree would hold. */
+typedef struct cJSON_Handler {
+	int (*null_value)(void *ctx);
+	int (*boolean)(void *ctx,int value);
+	int (*number)(void *ctx,const cJSON *item);
+	int (*string)(void *ctx,const char *str,size_t length);
+	int (*start_object)(void *ctx);
+	int (*key)(void *ctx,const char *str,size_t length);
+	int (*end_object)(void *ctx);
+	int (*start_array)(void *ctx);
+	int (*end_array)(void *ctx);
+	void *ctx;
+} cJSON_Handler;
+/* Parse length bytes of value with the grammar and checks of cJSON_ParseWithLengthError, reporting each value to handler.
+   Of the flags, only cJSON_ParseRequireNullTerminated applies. Returns 1, or 0 and fills error, if not 0, on failure or
+   when the handler stops ("stopped by handler"); the events before the failure have been delivered. The scratch buffer
+   for escaped strings, from the global hooks, is the only allocation. */
+extern int cJSON_ParseEvents(const char *value,size_t length,int flags,const cJSON_Handler *handler,cJSON_Error *error);
+
+/* Parsing a large array or object in runs of elements (members), e.g. on several threads. The index pass finds the ','
+   after every few elements, so the runs between them are about every bytes long: it fills up to max offsets in splits,
+   sets *end past the closing bracket, and returns their number. It only matches brackets and quotes: (size_t)-1 if the
+   value is not an array or object or they do not match. */
+extern size_t cJSON_SplitContainer(const char *value,size_t length,size_t every,size_t *splits,size_t max,size_t *end);
+/* Parse a run of elements (type cJSON_Array) or members (cJSON_Object), without brackets, into a new item of that type.
+   Flags as in cJSON_ParseWithError. Link the children of the runs in order to rebuild the container. */
+extern cJSON *cJSON_ParseRun(const char *value,size_t length,int type,int flags,const cJSON_Allocator *allocator,cJSON_Error *error);
+
+/* Calls taking an allocator. Calls without one use the global hooks for what they allocate. */
+extern cJSON *cJSON_ParseWithAllocator(const char *value,int flags,const cJSON_Allocator *allocator);
+extern void   cJSON_DeleteWithAllocator(cJSON *c,const cJSON_Allocator *allocator);
+/* Render with fmt as in cJSON_PrintBuffered. The allocator needs free_fn; release the text with cJSON_FreeWithAllocator. */
+extern char  *cJSON_PrintWithAllocator(cJSON *item,int fmt,const cJSON_Allocator *allocator);
+
+/* Destination for cJSON_PrintToSink: write gets the text in order, in chunks, and returns 0 to stop printing. */
+typedef struct cJSON_Sink {
+	int (*write)(void *ctx,const char *data,size_t len);
+	void *ctx;
+} cJSON_Sink;
+
+/* Render with fmt into memory the caller owns, without an intermediate copy. All return the length of the text,
+   without the terminating NUL, or (size_t)-1 on failure. */
+/* Into buffer of size bytes. A result >= size means the text did not fit: buffer holds part of it, print again with result+1 bytes. */
+extern size_t cJSON_PrintToBuffer(cJSON *item,char *buffer,size_t size,int fmt);
+/* Into buffer of size bytes, grown by resize(ctx,buffer,new_size), which returns a buffer of new_size bytes with the contents kept, or 0. */
+extern size_t cJSON_PrintToResizable(cJSON *item,int fmt,char *buffer,size_t size,char *(*resize)(void *ctx,char *buffer,size_t size),void *ctx);
+/* Through a buffer of chunk bytes (0 for 4k) handed to sink whenever it fills: memory stays bounded by the chunk size,
+   or by the longest string if that is larger. */
+extern size_t cJSON_PrintToSink(cJSON *item,int fmt,const cJSON_Sink *sink,size_t chunk);
+extern void   cJSON_FreeWithAllocator(void *ptr,const cJSON_Allocator *allocator);
+/* Create an item of type cJSON_NULL, cJSON_True, cJSON_False, cJSON_Array or cJSON_Object. */
+extern cJSON *cJSON_CreateWithAllocator(int type,const cJSON_Allocator *allocator);
+extern cJSON *cJSON_CreateNumberWithAllocator(double num,const cJSON_Allocator *allocator);
+extern cJSON *cJSON_CreateStringWithAllocator(const char *string,const cJSON_Allocator *allocator);
+/* The string is length bytes, copied once without scanning it for its end. */
+extern cJSON *cJSON_CreateStringWithLength(const char *string,size_t length,const cJSON_Allocator *allocator);
+extern void   cJSON_AddItemToObjectWithAllocator(cJSON *object,const char *string,cJSON *item,const cJSON_Allocator *allocator);
+extern void   cJSON_AddItemReferenceToArrayWithAllocator(cJSON *array,cJSON *item,const cJSON_Allocator *allocator);
+extern void   cJSON_AddItemReferenceToObjectWithAllocator(cJSON *object,const char *string,cJSON *item,const cJSON_Allocator *allocator);
+extern void   cJSON_IndexObjectWithAllocator(cJSON *object,const cJSON_Allocator *allocator);
 
 extern void cJSON_Minify(char *json);
 
@@ -139,8 +302,8 @@ extern void cJSON_Minify(char *json);
 #define cJSON_AddStringToObject(object,name,s)	cJSON_AddItemToObject(object, name, cJSON_CreateString(s))
 
 /* When assigning an integer value, it needs to be propagated to valuedouble too. */
-#define cJSON_SetIntValue(object,val)			((object)?(object)->valueint=(object)->valuedouble=(val):(val))
-#define cJSON_SetNumberValue(object,val)		((object)?(object)->valueint=(object)->valuedouble=(val):(val))
+#define cJSON_SetIntValue(object,val)			((object)?((object)->type&=~(cJSON_Int64|cJSON_Uint64),(object)->valueint=(object)->valuedouble=(val)):(val))
+#define cJSON_SetNumberValue(object,val)		((object)?((object)->type&=~(cJSON_Int64|cJSON_Uint64),(object)->valueint=(object)->valuedouble=(val)):(val))
 
 #ifdef __cplusplus
 }
@@ -5,18 +5,41 @@
 #define WITH_CPP11
 #endif
 
+#if __cplusplus >= 201703L
+#define WITH_CPP17
+#endif
+
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include <stdexcept>
 #include <string>
-#include <set>
+#include <map>
 #include <ostream>
+#include <sstream>
 #include <vector>
+#include <deque>
+#include <algorithm>
 
 #ifdef WITH_CPP11
 #include <memory>
+#include <exception>
 #include <initializer_list>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#ifdef WITH_CPP17
+#include <string_view>
+#endif
 #define _SHARED_PTR_IMPL std::shared_ptr
 #else
 #include <tr1/memory>
@@ -42,20 +65,448 @@ class JSONError: public std::runtime_error
 {
 public:
 	explicit JSONError(const char* what)
-		: std::runtime_error(what)
+		: std::runtime_error(what), offset_(0), line_(0), column_(0), reason_(what)
+	{
+	}
+
+	// parse error with its location
+	explicit JSONError(const cJSON_Error& err)
+		: std::runtime_error(describe(err)), offset_(err.offset),
+		  line_(err.line), column_(err.column), reason_(err.reason)
+	{
+	}
+
+	// byte offset, 1-based line and column of a parse error, 0 otherwise
+	size_t offset() const { return offset_; }
+	int line() const { return line_; }
+	int column() const { return column_; }
+
+	// error description without location
+	const char* reason() const { return reason_; }
+
+private:
+	static std::string describe(const cJSON_Error& err)
+	{
+		std::ostringstream os;
+		os << "Parse error: " << err.reason;
+		if (err.line > 0)
+			os << " at line " << err.line << ", column " << err.column;
+		return os.str();
+	}
+
+	size_t offset_;
+	int line_;
+	int column_;
+	// reason is a string literal, from cJSON or the throw site
+	const char* reason_;
+};
+
+namespace detail {
+
+// detects containers with reserve(size_type), e.g. std::vector or QVector
+template <typename C>
+class HasReserve
+{
+	typedef char yes;
+	typedef long no;
+	template <typename U, void (U::*)(typename U::size_type)> struct Sig;
+	template <typename U> static yes test(Sig<U, &U::reserve>*);
+	template <typename U> static no test(...);
+public:
+	enum { value = sizeof(test<C>(0)) == sizeof(yes) };
+};
+
+template <bool>
+struct Reserver
+{
+	template <typename C>
+	static void reserve(C&, int) {}
+};
+
+template <>
+struct Reserver<true>
+{
+	template <typename C>
+	static void reserve(C& c, int n) { c.reserve(n); }
+};
+
+template <typename C>
+inline void reserve(C& c, int n)
+{
+	Reserver<HasReserve<C>::value>::reserve(c, n);
+}
+
+// resize callback of cJSON_PrintToResizable for std::string
+inline char* resizeString(void* ctx, char*, size_t size)
+{
+	std::string* s = static_cast<std::string*>(ctx);
+	try {
+		s->resize(size);
+	} catch (...) {
+		// must not unwind through cJSON
+		return NULL;
+	}
+	return &(*s)[0];
+}
+
+// cJSON_Sink writing to an output iterator
+template <typename OutputIterator>
+int writeToIterator(void* ctx, const char* data, size_t len)
+{
+	OutputIterator& out = *static_cast<OutputIterator*>(ctx);
+	try {
+		out = std::copy(data, data + len, out);
+	} catch (...) {
+		return 0;
+	}
+	return 1;
+}
+
+// cJSON_Sink writing to a std::ostream
+inline int writeToStream(void* ctx, const char* data, size_t len)
+{
+	std::ostream& os = *static_cast<std::ostream*>(ctx);
+	try {
+		os.write(data, static_cast<std::streamsize>(len));
+	} catch (...) {
+		return 0;
+	}
+	return os.good();
+}
+
+// cJSON_Sink calling a functor
+template <typename Callback>
+int writeToCallback(void* ctx, const char* data, size_t len)
+{
+	try {
+		return (*static_cast<Callback*>(ctx))(data, len) ? 1 : 0;
+	} catch (...) {
+		return 0;
+	}
+}
+
+#ifndef _WIN32
+// cJSON_Sink writing to a file descriptor
+inline int writeToFd(void* ctx, const char* data, size_t len)
+{
+	int fd = *static_cast<int*>(ctx);
+	while (len > 0) {
+		ssize_t n = ::write(fd, data, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 0;
+		data += n;
+		len -= static_cast<size_t>(n);
+	}
+	return 1;
+}
+#endif
+
+// detects standard containers, which take an allocator parameter
+template <typename C>
+class HasAllocator
+{
+	typedef char yes;
+	typedef long no;
+	template <typename U> static yes test(typename U::allocator_type*);
+	template <typename U> static no test(...);
+public:
+	enum { value = sizeof(test<C>(0)) == sizeof(yes) };
+};
+
+// detects std::ostream and derived streams, so they do not bind as output iterators
+template <typename S>
+class IsOstream
+{
+	typedef char yes;
+	typedef long no;
+	static yes test(const std::ostream*);
+	static no test(...);
+public:
+	enum { value = sizeof(test(static_cast<S*>(0))) == sizeof(yes) };
+};
+
+// detects raw pointers, which have no bound and so do not bind as output iterators
+template <typename T>
+struct IsPointer { enum { value = 0 }; };
+
+template <typename T>
+struct IsPointer<T*> { enum { value = 1 }; };
+
+template <typename T>
+struct IsBool { enum { value = 0 }; };
+
+template <>
+struct IsBool<bool> { enum { value = 1 }; };
+
+template <bool B, typename T>
+struct EnableIf {};
+
+template <typename T>
+struct EnableIf<true, T> { typedef T type; };
+
+// shared state of an Allocator, documents allocated from it keep it alive
+struct AllocatorState
+{
+	cJSON_Allocator a;
+	AllocatorState() { a.malloc_fn = NULL; a.free_fn = NULL; a.ctx = NULL; }
+	virtual ~AllocatorState() {}
+	// a document allocated from it is created/dies
+	virtual void acquire() {}
+	virtual void release() {}
+	// give back the memory of a failed parse
+	virtual void reclaim() {}
+private:
+	explicit AllocatorState(const AllocatorState&);
+	AllocatorState& operator=(const AllocatorState&);
+};
+
+} // namespace detail
+
+// Allocator for documents, in place of the global cJSON_InitHooks ones. It is carried by the
+// document, so items added to it and the document itself are freed with the right allocator.
+// Copies of an Allocator share the same state.
+class Allocator
+{
+	friend class JSONObject;
+protected:
+	typedef _SHARED_PTR_IMPL<detail::AllocatorState> StatePtr;
+	StatePtr state_;
+
+	explicit Allocator(detail::AllocatorState* state) : state_(state) {}
+
+	template <typename Pool>
+	static void* poolMalloc(void* ctx, size_t sz) { return static_cast<Pool*>(ctx)->allocate(sz); }
+
+	template <typename Pool>
+	static void poolFree(void* ctx, void* ptr) { static_cast<Pool*>(ctx)->deallocate(ptr); }
+
+public:
+	// freeFn may be NULL for allocators releasing their memory in bulk
+	Allocator(void* (*mallocFn)(void* ctx, size_t sz), void (*freeFn)(void* ctx, void* ptr), void* ctx)
+		: state_(new detail::AllocatorState)
+	{
+		state_->a.malloc_fn = mallocFn;
+		state_->a.free_fn = freeFn;
+		state_->a.ctx = ctx;
+	}
+
+	// allocate from a pool object with void* allocate(size_t) and void deallocate(void*),
+	// e.g. a per-thread pool. The pool must outlive the documents.
+	template <typename Pool>
+	static Allocator forPool(Pool& pool)
+	{
+		return Allocator(&poolMalloc<Pool>, &poolFree<Pool>, &pool);
+	}
+
+	inline const cJSON_Allocator* get() const { return &state_->a; }
+
+	// release the memory of a failed parse, if the allocator can
+	inline void reclaim() const { state_->reclaim(); }
+};
+
+// Arena for parse trees. Items and strings of the documents allocated from it are carved out of
+// large blocks, and released at once when the last of these documents dies. The memory is then
+// reused by the next parse, so an arena kept per worker parses without touching malloc.
+class Arena: public Allocator
+{
+	struct State: public detail::AllocatorState {
+		cJSON_Arena* arena;
+#ifdef WITH_CPP11
+		// documents of one arena may die on different threads, e.g. records of an NdjsonReader
+		// batch: only the release that takes the count to 0 resets the arena
+		std::atomic<int> docs;
+#else
+		int docs;
+#endif
+		explicit State(cJSON_Arena* ar) : arena(ar), docs(0)
+		{
+			if (arena)
+				a = *cJSON_ArenaAllocator(arena);
+		}
+		~State() { cJSON_ArenaDestroy(arena); }
+
+#ifdef WITH_CPP11
+		void acquire() { docs.fetch_add(1, std::memory_order_relaxed); }
+		void release() { if (docs.fetch_sub(1, std::memory_order_acq_rel) == 1) cJSON_ArenaReset(arena); }
+		void reclaim() { if (docs.load(std::memory_order_acquire) == 0) cJSON_ArenaReset(arena); }
+#else
+		void acquire() { docs++; }
+		void release() { if (--docs == 0) cJSON_ArenaReset(arena); }
+		void reclaim() { if (docs == 0) cJSON_ArenaReset(arena); }
+#endif
+	};
+
+public:
+	// blockSize is the allocation unit, 0 picks the default (64k)
+	explicit Arena(size_t blockSize = 0)
+		: Allocator(new State(cJSON_ArenaCreate(blockSize)))
+	{
+		if (!static_cast<State*>(state_.get())->arena)
+			throw JSONError("Out of memory");
+	}
+
+	inline cJSON_Arena* arena() const { return static_cast<State*>(state_.get())->arena; }
+};
+
+// RFC 6901 JSON Pointer ("/a/b/3/c"), split into its reference tokens once so it can be
+// resolved against many documents. Resolving walks the cJSON items directly, only the
+// item at the end of the path gets a JSONObject.
+class CompiledPath
+{
+	struct Step {
+		std::string key;
+		// array index, -1 if the token is not one ("-" or leading zeros never match)
+		int index;
+	};
+	std::vector<Step> steps_;
+	std::string pointer_;
+
+	void compile(const char* p, size_t len)
+	{
+		if (len != 0 && *p != '/')
+			throw JSONError("Bad JSON pointer");
+		const char* end = p + len;
+		while (p < end) {
+			Step step;
+			step.index = -1;
+			for (p++; p < end && *p != '/'; p++) {
+				if (*p != '~') {
+					step.key += *p;
+					continue;
+				}
+				if (++p == end || (*p != '0' && *p != '1'))
+					throw JSONError("Bad JSON pointer");
+				step.key += *p == '0' ? '~' : '/';
+			}
+
+			const std::string& k = step.key;
+			if (!k.empty() && k.size() <= 9 && (k[0] != '0' || k.size() == 1)
+				&& k.find_first_not_of("0123456789") == std::string::npos)
+				step.index = atoi(k.c_str());
+			steps_.push_back(step);
+		}
+	}
+
+public:
+	explicit CompiledPath(const char* pointer)
+		: pointer_(pointer)
+	{
+		compile(pointer_.data(), pointer_.size());
+	}
+
+	explicit CompiledPath(const std::string& pointer)
+		: pointer_(pointer)
+	{
+		compile(pointer_.data(), pointer_.size());
+	}
+
+	inline const std::string& str() const { return pointer_; }
+
+	// number of reference tokens, 0 for "" (the whole document)
+	inline size_t size() const { return steps_.size(); }
+
+	// item at the path below root, NULL if there is none. Lazy containers on the way
+	// are expanded with the given allocator, which writes to the document (see Lazy)
+	cJSON* resolve(cJSON* root, const cJSON_Allocator* allocator) const
 	{
+		cJSON* item = root;
+		for (size_t i = 0; i < steps_.size() && item != NULL; i++) {
+			if (item->type & cJSON_Lazy) {
+				cJSON_Error err;
+				if (!cJSON_Expand(item, allocator, &err))
+					throw JSONError(err);
+			}
+			switch (item->type & 0xff) {
+			case cJSON_Object:
+				item = cJSON_GetObjectItemCaseSensitive(item, steps_[i].key.c_str());
+				break;
+			case cJSON_Array:
+				item = steps_[i].index >= 0 ? cJSON_GetArrayItem(item, steps_[i].index) : NULL;
+				break;
+			default:
+				item = NULL;
+			}
+		}
+		return item;
 	}
 };
 
+class JSONView;
+
 // JSONObject class is a thin wrapper over cJSON data type
 class JSONObject
 {
-	// internal cJSON holder with ownership flag
+	friend class JSONView;
+
+	struct Holder;
+	typedef _SHARED_PTR_IMPL<Holder> HolderPtr;
+	typedef std::map<cJSON*, JSONObject> ObjectMap;
+
+	// internal cJSON holder with ownership flag, shared by the copies of a JSONObject
 	struct Holder {
 		cJSON* o;
 		bool own_;
-		Holder(cJSON* obj, bool own) : o(obj), own_(own) {}
-		~Holder() { if (own_) cJSON_Delete(o); }
+		// allocator of the tree, empty for the global hooks
+		Allocator::StatePtr alloc_;
+#ifdef WITH_CPP11
+		// length of the last unformatted and formatted print, sizes the next one.
+		// Only a hint: the tree may have changed since, the buffer still grows as needed.
+		// Atomic, as threads may print the same document concurrently
+		std::atomic<size_t> printed_[2];
+#endif
+		// input of a tree parsed in situ, its strings point into it
+		_SHARED_PTR_IMPL<std::string> text_;
+		// holder of the item this one is a child of, kept alive as long as the child handle
+		HolderPtr parent_;
+		// Track added holders so that they are not destroyed prematurely before this object dies.
+		// A value the tree cannot take over (see adopt) is still owned by its other handles: it is
+		//   stored as a reference in the cJSON structure, and its holder is kept here under the
+		//   reference item so remove() finds it directly. Created on first use.
+		// Concurrency is not handled for performance reasons so it's better to avoid sharing
+		//   JSONObjects across threads.
+		ObjectMap* refs_;
+		Holder(cJSON* obj, bool own) : o(obj), own_(own), refs_(NULL) { init(); }
+		Holder(cJSON* obj, bool own, const Allocator::StatePtr& alloc)
+			: o(obj), own_(own), alloc_(alloc), refs_(NULL)
+		{
+			init();
+			if (own_ && alloc_)
+				alloc_->acquire();
+		}
+		~Holder()
+		{
+			delete refs_;
+			if (own_) {
+				cJSON_DeleteWithAllocator(o, allocator());
+				if (alloc_)
+					alloc_->release();
+			}
+		}
+
+		inline void init()
+		{
+#ifdef WITH_CPP11
+			printed_[0].store(0, std::memory_order_relaxed);
+			printed_[1].store(0, std::memory_order_relaxed);
+#endif
+		}
+
+		inline const cJSON_Allocator* allocator() const
+		{
+			return alloc_ ? &alloc_->a : NULL;
+		}
+
+		// holder at the top of the parent chain, which lives as long as the tree: child handles
+		// keep their shared values there, not in their own refs_, which die with the handle
+		inline Holder& owner()
+		{
+			Holder* h = this;
+			while (h->parent_)
+				h = h->parent_.get();
+			return *h;
+		}
 
 		inline cJSON* operator->()
 		{
@@ -69,346 +520,1980 @@ class JSONObject
 		Holder& operator=(const Holder&);
 	};
 
-	typedef _SHARED_PTR_IMPL<Holder> HolderPtr;
-
-	typedef std::set<JSONObject> ObjectSet;
-	typedef _SHARED_PTR_IMPL<ObjectSet> ObjectSetPtr;
-
 	// get value (specialized below)
 	template <typename T>
 	T as(cJSON* obj) const;
 
 	HolderPtr obj_;
 
-	// Track added holders so that they are not destroyed prematurely before this object dies.
-	// The idea behind it: when a value is added to the object or array it is stored as a reference
-	//   in the cJSON structure and also added to the holder set.
-	// Holders are stored in the shared set to make sure JSONObject copies will have it as well.
-	// This is only relevant for object and array types.
-	// Concurrency is not handled for performance reasons so it's better to avoid sharing JSONObjects
-	//   across threads.
-	ObjectSetPtr refs_;
+	// allocator for items added to the tree
+	inline const cJSON_Allocator* allocator() const
+	{
+		return obj_->allocator();
+	}
+
+	// the item of value for this tree to own, NULL if value has to stay shared: it must be the
+	// only handle on a root that keeps nothing else alive. A root from another allocator is
+	// taken over only if it is a scalar, by copying it with this tree's allocator
+	cJSON* adopt(JSONObject& value)
+	{
+		Holder& h = *value.obj_;
+		if (value.obj_.use_count() != 1 || !h.own_ || h.text_ || (h.refs_ && !h.refs_->empty()))
+			return NULL;
+		if (h.alloc_ == obj_->alloc_) {
+			h.own_ = false;
+			if (h.alloc_)
+				h.alloc_->release();
+			return h.o;
+		}
+
+		cJSON* c;
+		switch (h.o->type & 0xff) {
+		case cJSON_Array:
+		case cJSON_Object:
+			return NULL;
+		case cJSON_String:
+			c = cJSON_CreateStringWithAllocator(h.o->valuestring, allocator());
+			break;
+		case cJSON_Number:
+			c = cJSON_CreateNumberWithAllocator(h.o->valuedouble, allocator());
+			if (c) {
+				c->type = h.o->type & (0xff | cJSON_Int64 | cJSON_Uint64);
+				c->valueint = h.o->valueint;
+				c->valueint64 = h.o->valueint64;
+			}
+			break;
+		default:
+			c = cJSON_CreateWithAllocator(h.o->type & 0xff, allocator());
+		}
+		if (!c)
+			throw JSONError("Out of memory");
+		return c;
+	}
+
+	// hold value for the reference ref. A stale entry for the address (its reference was removed
+	// through another handle) is replaced
+	inline void keep(cJSON* ref, const JSONObject& value)
+	{
+		Holder& h = obj_->owner();
+		if (!h.refs_)
+			h.refs_ = new ObjectMap;
+		std::pair<ObjectMap::iterator, bool> r = h.refs_->insert(std::make_pair(ref, value));
+		if (!r.second)
+			r.first->second = value;
+	}
+
+	JSONObject emplace(int type)
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+		cJSON* item = cJSON_CreateWithAllocator(type, allocator());
+		if (!item)
+			throw JSONError("Out of memory");
+		cJSON_AddItemToArray(node(), item);
+		return JSONObject(*this, item, false);
+	}
+
+	JSONObject emplace(const char* name, int type)
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object type");
+		cJSON* item = cJSON_CreateWithAllocator(type, allocator());
+		if (!item)
+			throw JSONError("Out of memory");
+		cJSON_AddItemToObjectWithAllocator(node(), name, item, allocator());
+		return JSONObject(*this, item, false);
+	}
+
+	inline void addItem(JSONObject& value)
+	{
+		cJSON* item = adopt(value);
+		if (item) {
+			cJSON_AddItemToArray(node(), item);
+			return;
+		}
+		cJSON_AddItemReferenceToArrayWithAllocator(node(), value.node(), allocator());
+		keep(node()->tail, value);
+	}
+
+	inline void setItem(const char* name, JSONObject& value)
+	{
+		cJSON* item = adopt(value);
+		if (item) {
+			cJSON_AddItemToObjectWithAllocator(node(), name, item, allocator());
+			return;
+		}
+		cJSON_AddItemReferenceToObjectWithAllocator(node(), name, value.node(), allocator());
+		keep(node()->tail, value);
+	}
+
+	// items for scalar values, created directly with the tree's allocator. Other types are built
+	// as a JSONObject first (NULL here)
+	template <typename T>
+	inline cJSON* scalar(const T&) const { return NULL; }
+
+	inline cJSON* scalar(bool value) const
+	{
+		return cJSON_CreateWithAllocator(value ? cJSON_True : cJSON_False, allocator());
+	}
+
+	inline cJSON* scalar(int value) const
+	{
+		return cJSON_CreateNumberWithAllocator(value, allocator());
+	}
+
+	inline cJSON* scalar(double value) const
+	{
+		return cJSON_CreateNumberWithAllocator(value, allocator());
+	}
+
+	inline cJSON* scalar(int64_t value) const
+	{
+		cJSON* c = cJSON_CreateNumberWithAllocator(static_cast<double>(value), allocator());
+		if (c) {
+			c->type |= cJSON_Int64;
+			c->valueint64 = value;
+		}
+		return c;
+	}
+
+	inline cJSON* scalar(uint64_t value) const
+	{
+		if (value <= static_cast<uint64_t>(INT64_MAX))
+			return scalar(static_cast<int64_t>(value));
+		cJSON* c = cJSON_CreateNumberWithAllocator(static_cast<double>(value), allocator());
+		if (c) {
+			c->type |= cJSON_Int64 | cJSON_Uint64;
+			c->valueint64 = static_cast<int64_t>(value - static_cast<uint64_t>(INT64_MAX) - 1) + INT64_MIN;
+		}
+		return c;
+	}
+
+	inline cJSON* scalar(const char* value) const
+	{
+		return cJSON_CreateStringWithAllocator(value, allocator());
+	}
+
+	// one copy of the known length, no strlen
+	inline cJSON* scalar(const std::string& value) const
+	{
+		return cJSON_CreateStringWithLength(value.data(), value.size(), allocator());
+	}
 
 public:
 	inline cJSON* obj() const { return obj_->o; }
 
-	std::string print(bool formatted=true) const
+	// the cJSON item with its children parsed, expanding it if it was left lazy: const,
+	// but it writes to the document (see Lazy)
+	inline cJSON* node() const
 	{
-		char* json = formatted ? cJSON_Print(obj_->o) : cJSON_PrintUnformatted(obj_->o);
-		std::string retval(json);
-		free(json);
-		return retval;
+		if (obj_->o->type & cJSON_Lazy) {
+			cJSON_Error err;
+			if (!cJSON_Expand(obj_->o, allocator(), &err))
+				throw JSONError(err);
+		}
+		return obj_->o;
 	}
 
-	// necessary for holding references in the set
-	bool operator < (const JSONObject& other) const
+	// read-only view of this item, see JSONView
+	inline JSONView view() const;
+
+	// forward iterator over array (or object) elements, walks the child chain once
+	class const_iterator
 	{
-		return obj_->o < other.obj_->o;
+		const JSONObject* parent_;
+		cJSON* cur_;
+	public:
+		const_iterator(const JSONObject* parent, cJSON* cur) : parent_(parent), cur_(cur) {}
+
+		inline JSONObject operator*() const;
+
+		// get value of the current element
+		template <typename T>
+		inline T as() const
+		{
+			return parent_->as<T>(cur_);
+		}
+
+		// name of the current element when iterating an object
+		inline const char* name() const
+		{
+			return cur_->string;
+		}
+
+		inline cJSON* obj() const { return cur_; }
+
+		inline const_iterator& operator++()
+		{
+			cur_ = cur_->next;
+			return *this;
+		}
+
+		inline const_iterator operator++(int)
+		{
+			const_iterator tmp(*this);
+			cur_ = cur_->next;
+			return tmp;
+		}
+
+		inline bool operator==(const const_iterator& other) const { return cur_ == other.cur_; }
+		inline bool operator!=(const const_iterator& other) const { return cur_ != other.cur_; }
+	};
+
+	inline const_iterator begin() const
+	{
+		return const_iterator(this, node()->child);
 	}
 
-	// create empty object
-	JSONObject()
-		: obj_(new Holder(cJSON_CreateObject(), true)),
-		  refs_(new ObjectSet)
+	inline const_iterator end() const
 	{
+		return const_iterator(this, NULL);
 	}
 
-	// non-virtual destructor (no subclassing intended)
-	~JSONObject()
+	// number of elements in array or object
+	inline int size() const
 	{
+		return cJSON_GetArraySize(node());
 	}
 
-	// wrap existing cJSON object
-	JSONObject(cJSON* obj, bool own)
-		: obj_(new Holder(obj, own)),
-		  refs_(new ObjectSet)
+	// use a hash index for get/has/remove by name, worthwhile for objects with many keys
+	inline void indexKeys()
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object type");
+		cJSON_IndexObjectWithAllocator(node(), allocator());
+	}
+
+	// match keys exactly ("Id" and "id" are different) in get/has/remove by name
+	inline void caseSensitiveKeys()
 	{
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object type");
+		node()->type |= cJSON_CaseSensitive;
 	}
 
-	// wrap existing cJSON object with parent
-	JSONObject(JSONObject parent, cJSON* obj, bool own)
-		: obj_(new Holder(obj, own)),
-		  refs_(new ObjectSet)
+	std::string print(bool formatted=true) const
 	{
-		refs_->insert(parent);
+		std::string retval;
+		print_to(retval, formatted);
+		return retval;
 	}
 
-	// create boolean object
-	explicit JSONObject(bool value)
-		: obj_(new Holder(value ? cJSON_CreateTrue() : cJSON_CreateFalse(), true))
+	// length of the text print() returns, measured without printing
+	size_t printed_length(bool formatted=true) const
+	{
+		size_t len = cJSON_PrintedLength(obj_->o, formatted);
+		if (len == static_cast<size_t>(-1))
+			throw JSONError("Not a printable type");
+		return len;
+	}
+
+	// print into out, reusing its memory: keep one string per connection to avoid
+	// allocating per response. Returns the length.
+	// The first print of an object measures it, later ones reuse the last length (C++11), so
+	// out is allocated once unless the object grew.
+	size_t print_to(std::string& out, bool formatted=true) const
+	{
+#ifdef WITH_CPP11
+		std::atomic<size_t>& last = obj_->printed_[formatted ? 1 : 0];
+		size_t hint = last.load(std::memory_order_relaxed);
+		if (!hint)
+			hint = printed_length(formatted);
+#else
+		size_t hint = printed_length(formatted);
+#endif
+		out.resize(std::max(out.capacity(), hint + 1));
+		size_t len = cJSON_PrintToResizable(obj_->o, formatted, &out[0], out.size(),
+											detail::resizeString, &out);
+		if (len == static_cast<size_t>(-1)) {
+			out.clear();
+			throw JSONError("Out of memory");
+		}
+		out.resize(len);
+#ifdef WITH_CPP11
+		last.store(len, std::memory_order_relaxed);
+#endif
+		return len;
+	}
+
+	// print into buf of cap bytes, NUL-terminated. Returns the length: if it is
+	// cap or more, the text did not fit and buf holds only part of it.
+	size_t print_to(char* buf, size_t cap, bool formatted=true) const
+	{
+		size_t len = cJSON_PrintToBuffer(obj_->o, buf, cap, formatted);
+		if (len == static_cast<size_t>(-1))
+			throw JSONError("Out of memory");
+		return len;
+	}
+
+#ifdef WITH_CPP11
+	// print_to(buf, false) would take false as a cap of 0 and print nothing: pass the size
+	template <typename Bool>
+	typename detail::EnableIf<detail::IsBool<Bool>::value, size_t>::type
+	print_to(char* buf, Bool formatted) const = delete;
+#endif
+
+	// print to an output iterator, e.g. std::back_inserter(vec) or
+	// std::ostreambuf_iterator<char>(os), in chunks. Returns the iterator past the text.
+	// Raw pointers are not taken: print into a buffer with print_to(buf, cap).
+	template <typename OutputIterator>
+	typename detail::EnableIf<!detail::IsOstream<OutputIterator>::value && !detail::IsPointer<OutputIterator>::value,
+		OutputIterator>::type
+	print_to(OutputIterator out, bool formatted=true) const
+	{
+		cJSON_Sink sink = { detail::writeToIterator<OutputIterator>, &out };
+		if (cJSON_PrintToSink(obj_->o, formatted, &sink, 0) == static_cast<size_t>(-1))
+			throw JSONError("Print failed");
+		return out;
+	}
+
+	// stream to os in chunks of chunk bytes: the document is never held in memory as text.
+	// Returns the length written.
+	size_t print_to(std::ostream& os, bool formatted=true, size_t chunk=65536) const
+	{
+		cJSON_Sink sink = { detail::writeToStream, &os };
+		size_t len = cJSON_PrintToSink(obj_->o, formatted, &sink, chunk);
+		if (len == static_cast<size_t>(-1)) {
+			os.setstate(std::ios_base::failbit);
+			throw JSONError("Write failed");
+		}
+		return len;
+	}
+
+	// stream to cb(const char* data, size_t len) in chunks; cb returns false to stop,
+	// which throws JSONError. Returns the length written.
+	template <typename Callback>
+	size_t print_chunks(Callback cb, bool formatted=true, size_t chunk=65536) const
+	{
+		cJSON_Sink sink = { detail::writeToCallback<Callback>, &cb };
+		size_t len = cJSON_PrintToSink(obj_->o, formatted, &sink, chunk);
+		if (len == static_cast<size_t>(-1))
+			throw JSONError("Write failed");
+		return len;
+	}
+
+#ifndef _WIN32
+	// stream to a file descriptor (file, pipe or socket) in chunks. Returns the length written.
+	size_t print_to_fd(int fd, bool formatted=true, size_t chunk=65536) const
+	{
+		cJSON_Sink sink = { detail::writeToFd, &fd };
+		size_t len = cJSON_PrintToSink(obj_->o, formatted, &sink, chunk);
+		if (len == static_cast<size_t>(-1))
+			throw JSONError("Write failed");
+		return len;
+	}
+#endif
+
+	// necessary for holding references in the set
+	bool operator < (const JSONObject& other) const
+	{
+		return obj_->o < other.obj_->o;
+	}
+
+	// create empty object
+	JSONObject()
+		: obj_(new Holder(cJSON_CreateObject(), true))
+	{
+	}
+
+	// non-virtual destructor (no subclassing intended)
+	~JSONObject()
+	{
+	}
+
+	// wrap existing cJSON object
+	JSONObject(cJSON* obj, bool own)
+		: obj_(new Holder(obj, own))
+	{
+	}
+
+	// wrap existing cJSON object with parent
+	JSONObject(const JSONObject& parent, cJSON* obj, bool own)
+		: obj_(new Holder(obj, own, parent.obj_->alloc_))
+	{
+		obj_->parent_ = parent.obj_;
+	}
+
+	// wrap and own a tree allocated with alloc
+	JSONObject(cJSON* obj, const Allocator& alloc)
+		: obj_(new Holder(obj, true, alloc.state_))
+	{
+	}
+
+	// wrap and own a tree parsed in situ from text (see parseInSitu), keeping text alive
+	JSONObject(cJSON* obj, const _SHARED_PTR_IMPL<std::string>& text)
+		: obj_(new Holder(obj, true))
+	{
+		obj_->text_ = text;
+	}
+
+	JSONObject(cJSON* obj, const _SHARED_PTR_IMPL<std::string>& text, const Allocator& alloc)
+		: obj_(new Holder(obj, true, alloc.state_))
+	{
+		obj_->text_ = text;
+	}
+
+	// create empty object with allocator
+	explicit JSONObject(const Allocator& alloc)
+		: obj_(new Holder(cJSON_CreateWithAllocator(cJSON_Object, alloc.get()), true, alloc.state_))
+	{
+	}
+
+	// create boolean object
+	explicit JSONObject(bool value)
+		: obj_(new Holder(value ? cJSON_CreateTrue() : cJSON_CreateFalse(), true))
+	{
+	}
+
+	// create double object
+	explicit JSONObject(double value)
+		: obj_(new Holder(cJSON_CreateNumber(value), true))
+	{
+	}
+
+	// create integer object
+	explicit JSONObject(int value)
+		: obj_(new Holder(cJSON_CreateNumber(static_cast<double>(value)), true))
+	{
+	}
+
+	// create integer object, printed exactly
+	explicit JSONObject(int64_t value)
+		: obj_(new Holder(cJSON_CreateInt64(value), true))
+	{
+	}
+
+	explicit JSONObject(uint64_t value)
+		: obj_(new Holder(cJSON_CreateUint64(value), true))
+	{
+	}
+
+	// create string object
+	explicit JSONObject(const char* value)
+		: obj_(new Holder(cJSON_CreateString(value), true))
+	{
+	}
+
+	explicit JSONObject(const std::string& value)
+		: obj_(new Holder(cJSON_CreateString(value.c_str()), true))
+	{
+	}
+
+	// create array object
+#ifdef WITH_CPP11
+	template <typename T,
+			  template<typename X, typename A> class ContT=std::vector>
+#else
+	template <typename T,
+			  template<typename X, typename A> class ContT>
+#endif
+	explicit JSONObject(const ContT<T, std::allocator<T> >& elems)
+		: obj_(new Holder(cJSON_CreateArray(), true))
+	{
+		for (typename ContT<T, std::allocator<T> >::const_iterator it = elems.begin();
+			 it != elems.end(); it++)
+			add(*it);
+	}
+#ifdef WITH_CPP11
+	template <typename T>
+	JSONObject(const std::initializer_list<T>& elems)
+		: obj_(new Holder(cJSON_CreateArray(), true))
+	{
+		for (auto& it: elems)
+			add(it);
+	}
+#endif
+	// for Qt-style containers
+	template <typename T,
+			  template<typename X> class ContT>
+	explicit JSONObject(const ContT<T>& elems)
+		: obj_(new Holder(cJSON_CreateArray(), true))
+	{
+		for (typename ContT<T>::const_iterator it = elems.begin(); it != elems.end(); it++)
+			add(*it);
+	}
+
+	// copy constructor
+	JSONObject(const JSONObject& other)
+		: obj_(other.obj_)
+	{
+	}
+
+	// copy operator
+	inline JSONObject& operator=(const JSONObject& other)
+	{
+		if (&other != this) {
+			obj_ = other.obj_;
+		}
+		return *this;
+	}
+
+#ifdef WITH_CPP11
+	// move constructor, other is left empty: only assigning to it or destroying it is valid
+	JSONObject(JSONObject&& other) noexcept
+		: obj_(std::move(other.obj_))
+	{
+	}
+
+	inline JSONObject& operator=(JSONObject&& other) noexcept
+	{
+		if (&other != this) {
+			obj_ = std::move(other.obj_);
+		}
+		return *this;
+	}
+#endif
+
+	// get object type
+	inline JSONType type() const
+	{
+		static JSONType vmap[] = {
+			Bool, Bool, Null, Number,
+			String, Array, Object
+		};
+		return vmap[(*obj_)->type & 0xff];
+	}
+
+	// get value from this object
+	template <typename T>
+	inline T as() const
+	{
+		return as<T>(obj_->o);
+	}
+
+	// get array
+#ifdef WITH_CPP11
+	template <typename T=JSONObject,
+			  template<typename X, typename A> class ContT=std::vector>
+#else
+	template <typename T, template<typename X, typename A> class ContT>
+#endif
+	inline ContT<T, std::allocator<T> > asArray() const
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+
+		ContT<T, std::allocator<T> > retval;
+		detail::reserve(retval, size());
+		for (cJSON* c = node()->child; c != NULL; c = c->next)
+			retval.push_back(as<T>(c));
+
+		return retval;
+	}
+
+	// for Qt-style containers (since C++17 std::vector matches ContT too, so skip those)
+	template <typename T, template<typename X> class ContT>
+	inline typename detail::EnableIf<!detail::HasAllocator<ContT<T> >::value, ContT<T> >::type
+	asArray() const
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+
+		ContT<T> retval;
+		detail::reserve(retval, size());
+		for (cJSON* c = node()->child; c != NULL; c = c->next)
+			retval.push_back(as<T>(c));
+
+		return retval;
+	}
+
+	// get object by name
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T get(const char* name) const
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object");
+
+		cJSON* item = cJSON_GetObjectItem(node(), name);
+		if (item != NULL)
+			return as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+	// get object by name of the given length, the name need not be null terminated
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T get(const char* name, size_t len) const
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object");
+
+		cJSON* item = cJSON_GetObjectItemWithLength(node(), name, len);
+		if (item != NULL)
+			return as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T get(const std::string& name) const
+	{
+		return get<T>(name.data(), name.size());
+	}
+
+	inline bool has(const char* name) const
+	{
+		return cJSON_GetObjectItem(node(), name) != NULL;
+	}
+
+	inline bool has(const char* name, size_t len) const
+	{
+		return cJSON_GetObjectItemWithLength(node(), name, len) != NULL;
+	}
+
+	inline bool has(const std::string& name) const
+	{
+		return has(name.data(), name.size());
+	}
+
+	// get value by JSON pointer, e.g. at("/a/b/3/c"). Keys match exactly
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T at(const CompiledPath& path) const
+	{
+		cJSON* item = path.resolve(obj_->o, allocator());
+		if (item != NULL)
+			return as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T at(const char* pointer) const
+	{
+		return at<T>(CompiledPath(pointer));
+	}
+
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T at(const std::string& pointer) const
+	{
+		return at<T>(CompiledPath(pointer));
+	}
+
+	inline bool has(const CompiledPath& path) const
+	{
+		return path.resolve(obj_->o, allocator()) != NULL;
+	}
+
+	// get value from array
+#ifdef WITH_CPP11
+	template <typename T=JSONObject>
+#else
+	template <typename T>
+#endif
+	inline T get(int index) const
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+
+		cJSON* item = cJSON_GetArrayItem(node(), index);
+		if (item != NULL)
+			return as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+	// add value to array
+	template <typename T>
+	inline void add(const T& value)
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+		cJSON* item = scalar(value);
+		if (item) {
+			cJSON_AddItemToArray(node(), item);
+			return;
+		}
+		JSONObject o(value);
+		addItem(o);
+	}
+
+#ifdef WITH_CPP11
+	// add value to array, moving it into the tree when this is its only handle; value is left empty
+	inline void add(JSONObject&& value)
+	{
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+		addItem(value);
+		value.obj_.reset();
+	}
+#endif
+
+	// set value in object
+	template <typename T>
+	inline void set(const char* name, const T& value) {
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object type");
+		cJSON* item = scalar(value);
+		if (item) {
+			cJSON_AddItemToObjectWithAllocator(node(), name, item, allocator());
+			return;
+		}
+		JSONObject o(value);
+		setItem(name, o);
+	}
+
+#ifdef WITH_CPP11
+	// set value in object, moving it into the tree when this is its only handle; value is left empty
+	inline void set(const char* name, JSONObject&& value) {
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object type");
+		setItem(name, value);
+		value.obj_.reset();
+	}
+
+	inline void set(const std::string& name, JSONObject&& value) {
+		set(name.c_str(), std::move(value));
+	}
+#endif
+
+	// set value in object
+	template <typename T>
+	inline void set(const std::string& name, const T& value) {
+		set(name.c_str(), value);
+	}
+
+	// set value in object (std::string)
+	inline void set(const std::string& name, const JSONObject& value) {
+		return set(name.c_str(), value);
+	}
+
+	// append an empty object or array to array and return a handle to fill it in. It is created
+	// in place with the tree's allocator, nothing is built apart and moved or referenced
+	inline JSONObject emplaceObject()
+	{
+		return emplace(cJSON_Object);
+	}
+
+	inline JSONObject emplaceArray()
+	{
+		return emplace(cJSON_Array);
+	}
+
+	// set an empty object or array in object, as above
+	inline JSONObject emplaceObject(const char* name)
+	{
+		return emplace(name, cJSON_Object);
+	}
+
+	inline JSONObject emplaceObject(const std::string& name)
+	{
+		return emplace(name.c_str(), cJSON_Object);
+	}
+
+	inline JSONObject emplaceArray(const char* name)
+	{
+		return emplace(name, cJSON_Array);
+	}
+
+	inline JSONObject emplaceArray(const std::string& name)
+	{
+		return emplace(name.c_str(), cJSON_Array);
+	}
+
+	// remove item from object
+	inline void remove(const char* name) {
+		if (((*obj_)->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object type");
+		cJSON* detached = cJSON_DetachItemFromObject(node(), name);
+		if (!detached)
+			throw JSONError("No such item");
+		if ((detached->type & cJSON_IsReference) && obj_->owner().refs_)
+			obj_->owner().refs_->erase(detached);
+		cJSON_DeleteWithAllocator(detached, allocator());
+	}
+
+	inline void remove(const std::string& name) {
+		return remove(name.c_str());
+	}
+
+	// remove item from array
+	inline void remove(int index) {
+		if (((*obj_)->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+		cJSON* detached = cJSON_DetachItemFromArray(node(), index);
+		if (!detached)
+			throw JSONError("No such item");
+		if ((detached->type & cJSON_IsReference) && obj_->owner().refs_)
+			obj_->owner().refs_->erase(detached);
+		cJSON_DeleteWithAllocator(detached, allocator());
+	}
+};
+
+// Read-only handle on an item inside a document: the cJSON item plus a copy of the handle it was
+// reached from, which keeps the document alive. Unlike the JSONObject returned for a child,
+// which gets its own holder, getting, iterating and resolving paths through views allocates
+// nothing. Use as<JSONObject>() to get a handle that can modify the item.
+class JSONView
+{
+	cJSON* o_;
+	JSONObject root_;
+
+public:
+	JSONView(const JSONObject& root, cJSON* obj) : o_(obj), root_(root) {}
+
+	inline cJSON* obj() const { return o_; }
+
+	// the cJSON item with its children parsed, expanding it if it was left lazy (see Lazy)
+	inline cJSON* node() const
+	{
+		if (o_->type & cJSON_Lazy) {
+			cJSON_Error err;
+			if (!cJSON_Expand(o_, root_.allocator(), &err))
+				throw JSONError(err);
+		}
+		return o_;
+	}
+
+	// forward iterator over array (or object) elements, yields views
+	class const_iterator
+	{
+		const JSONObject* root_;
+		cJSON* cur_;
+	public:
+		const_iterator(const JSONObject* root, cJSON* cur) : root_(root), cur_(cur) {}
+
+		inline JSONView operator*() const { return JSONView(*root_, cur_); }
+
+		// get value of the current element
+		template <typename T>
+		inline T as() const
+		{
+			return root_->as<T>(cur_);
+		}
+
+		// name of the current element when iterating an object
+		inline const char* name() const
+		{
+			return cur_->string;
+		}
+
+		inline cJSON* obj() const { return cur_; }
+
+		inline const_iterator& operator++()
+		{
+			cur_ = cur_->next;
+			return *this;
+		}
+
+		inline const_iterator operator++(int)
+		{
+			const_iterator tmp(*this);
+			cur_ = cur_->next;
+			return tmp;
+		}
+
+		inline bool operator==(const const_iterator& other) const { return cur_ == other.cur_; }
+		inline bool operator!=(const const_iterator& other) const { return cur_ != other.cur_; }
+	};
+
+	inline const_iterator begin() const
+	{
+		return const_iterator(&root_, node()->child);
+	}
+
+	inline const_iterator end() const
+	{
+		return const_iterator(&root_, NULL);
+	}
+
+	// number of elements in array or object
+	inline int size() const
+	{
+		return cJSON_GetArraySize(node());
+	}
+
+	// get value of this item
+	template <typename T>
+	inline T as() const
+	{
+		return root_.as<T>(o_);
+	}
+
+	// get array
+#ifdef WITH_CPP11
+	template <typename T=JSONView,
+			  template<typename X, typename A> class ContT=std::vector>
+#else
+	template <typename T, template<typename X, typename A> class ContT>
+#endif
+	inline ContT<T, std::allocator<T> > asArray() const
+	{
+		if ((o_->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+
+		ContT<T, std::allocator<T> > retval;
+		detail::reserve(retval, size());
+		for (cJSON* c = node()->child; c != NULL; c = c->next)
+			retval.push_back(root_.as<T>(c));
+
+		return retval;
+	}
+
+	// for Qt-style containers
+	template <typename T, template<typename X> class ContT>
+	inline typename detail::EnableIf<!detail::HasAllocator<ContT<T> >::value, ContT<T> >::type
+	asArray() const
+	{
+		if ((o_->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+
+		ContT<T> retval;
+		detail::reserve(retval, size());
+		for (cJSON* c = node()->child; c != NULL; c = c->next)
+			retval.push_back(root_.as<T>(c));
+
+		return retval;
+	}
+
+	// get object by name
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T get(const char* name) const
+	{
+		if ((o_->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object");
+
+		cJSON* item = cJSON_GetObjectItem(node(), name);
+		if (item != NULL)
+			return root_.as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+	// get object by name of the given length, the name need not be null terminated
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T get(const char* name, size_t len) const
+	{
+		if ((o_->type & 0xff) != cJSON_Object)
+			throw JSONError("Not an object");
+
+		cJSON* item = cJSON_GetObjectItemWithLength(node(), name, len);
+		if (item != NULL)
+			return root_.as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T get(const std::string& name) const
+	{
+		return get<T>(name.data(), name.size());
+	}
+
+	inline bool has(const char* name) const
+	{
+		return cJSON_GetObjectItem(node(), name) != NULL;
+	}
+
+	inline bool has(const char* name, size_t len) const
+	{
+		return cJSON_GetObjectItemWithLength(node(), name, len) != NULL;
+	}
+
+	inline bool has(const std::string& name) const
+	{
+		return has(name.data(), name.size());
+	}
+
+	// get value by JSON pointer, see JSONObject::at
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T at(const CompiledPath& path) const
+	{
+		cJSON* item = path.resolve(o_, root_.allocator());
+		if (item != NULL)
+			return root_.as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T at(const char* pointer) const
+	{
+		return at<T>(CompiledPath(pointer));
+	}
+
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T at(const std::string& pointer) const
+	{
+		return at<T>(CompiledPath(pointer));
+	}
+
+	inline bool has(const CompiledPath& path) const
+	{
+		return path.resolve(o_, root_.allocator()) != NULL;
+	}
+
+	// get value from array
+#ifdef WITH_CPP11
+	template <typename T=JSONView>
+#else
+	template <typename T>
+#endif
+	inline T get(int index) const
+	{
+		if ((o_->type & 0xff) != cJSON_Array)
+			throw JSONError("Not an array type");
+
+		cJSON* item = cJSON_GetArrayItem(node(), index);
+		if (item != NULL)
+			return root_.as<T>(item);
+		else
+			throw JSONError("No such item");
+	}
+
+	std::string print(bool formatted=true) const
+	{
+		return JSONObject(root_, o_, false).print(formatted);
+	}
+
+	size_t printed_length(bool formatted=true) const
+	{
+		size_t len = cJSON_PrintedLength(o_, formatted);
+		if (len == static_cast<size_t>(-1))
+			throw JSONError("Not a printable type");
+		return len;
+	}
+};
+
+// parse flags
+enum ParseFlags {
+	// index keys of large objects (see JSONObject::indexKeys)
+	IndexKeys = cJSON_ParseIndexKeys,
+	// match keys of all objects exactly (see JSONObject::caseSensitiveKeys)
+	CaseSensitive = cJSON_ParseCaseSensitive,
+	// reject trailing data after the value
+	RequireNullTerminated = cJSON_ParseRequireNullTerminated,
+	// parse nested arrays and objects only when get(), asArray(), size() or iteration first
+	// touches them; untouched ones print as their input text. The document keeps a copy of the input.
+	// Reads expand the document in place, so unlike a fully parsed one it must not be read
+	// from several threads at once: guard it with a lock, or parse without Lazy
+	Lazy = cJSON_ParseLazy
+};
+
+// a distinct flags type keeps parse(data, len) from matching parse(str, flags)
+inline ParseFlags operator|(ParseFlags a, ParseFlags b)
+{
+	return static_cast<ParseFlags>(static_cast<int>(a) | static_cast<int>(b));
+}
+
+namespace detail {
+
+// a lazy document parses its input whenever a part of it is first touched: parse a copy it keeps
+inline JSONObject parseLazy(const char* data, size_t len, const Allocator* alloc, ParseFlags flags)
+{
+	_SHARED_PTR_IMPL<std::string> text(new std::string(data, len));
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseWithLengthError(text->data(), text->size(), flags,
+											  alloc ? alloc->get() : NULL, &err);
+	if (cjson)
+		return alloc ? JSONObject(cjson, text, *alloc) : JSONObject(cjson, text);
+	if (alloc)
+		alloc->reclaim();
+	throw JSONError(err);
+}
+
+} // namespace detail
+
+// parse len bytes of data, which need not be NUL-terminated (nothing past data + len is read)
+inline JSONObject parse(const char* data, size_t len, ParseFlags flags = ParseFlags())
+{
+	if (flags & Lazy)
+		return detail::parseLazy(data, len, NULL, flags);
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseWithLengthError(data, len, flags, 0, &err);
+	if (cjson)
+		return JSONObject(cjson, true);
+	else
+		throw JSONError(err);
+}
+
+// parse from C string, throws JSONError with the failure location
+inline JSONObject parse(const char* str, ParseFlags flags = ParseFlags())
+{
+	if ((flags & Lazy) && str)
+		return detail::parseLazy(str, strlen(str), NULL, flags);
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseWithError(str, flags, 0, &err);
+	if (cjson)
+		return JSONObject(cjson, true);
+	else
+		throw JSONError(err);
+}
+
+// parse from std::string
+inline JSONObject parse(const std::string& str, ParseFlags flags = ParseFlags())
+{
+	return parse(str.data(), str.size(), flags);
+}
+
+// parse len bytes of data with allocator (or into an Arena)
+inline JSONObject parse(const char* data, size_t len, const Allocator& alloc,
+						ParseFlags flags = ParseFlags())
+{
+	if (flags & Lazy)
+		return detail::parseLazy(data, len, &alloc, flags);
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseWithLengthError(data, len, flags, alloc.get(), &err);
+	if (cjson)
+		return JSONObject(cjson, alloc);
+	alloc.reclaim();
+	throw JSONError(err);
+}
+
+// parse from C string with allocator (or into an Arena)
+inline JSONObject parse(const char* str, const Allocator& alloc, ParseFlags flags = ParseFlags())
+{
+	if ((flags & Lazy) && str)
+		return detail::parseLazy(str, strlen(str), &alloc, flags);
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseWithError(str, flags, alloc.get(), &err);
+	if (cjson)
+		return JSONObject(cjson, alloc);
+	alloc.reclaim();
+	throw JSONError(err);
+}
+
+// parse from std::string with allocator (or into an Arena)
+inline JSONObject parse(const std::string& str, const Allocator& alloc, ParseFlags flags = ParseFlags())
+{
+	return parse(str.data(), str.size(), alloc, flags);
+}
+
+#ifdef WITH_CPP17
+// parse from std::string_view, e.g. a view of a network buffer or mmap'd file
+inline JSONObject parse(std::string_view str, ParseFlags flags = ParseFlags())
+{
+	return parse(str.data(), str.size(), flags);
+}
+
+inline JSONObject parse(std::string_view str, const Allocator& alloc, ParseFlags flags = ParseFlags())
+{
+	return parse(str.data(), str.size(), alloc, flags);
+}
+#endif
+
+// parse len bytes of data in place: strings are unescaped inside data and point into it, none
+// is copied. data is modified (also on failure) and must outlive the document.
+inline JSONObject parseInSitu(char* data, size_t len, ParseFlags flags = ParseFlags())
+{
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseInSitu(data, len, flags, 0, &err);
+	if (cjson)
+		return JSONObject(cjson, true);
+	else
+		throw JSONError(err);
+}
+
+inline JSONObject parseInSitu(char* data, size_t len, const Allocator& alloc, ParseFlags flags = ParseFlags())
+{
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseInSitu(data, len, flags, alloc.get(), &err);
+	if (cjson)
+		return JSONObject(cjson, alloc);
+	alloc.reclaim();
+	throw JSONError(err);
+}
+
+// parse text in place, the document keeps it: its strings stay valid as long as any part of the
+// document is alive. Pass an rvalue (std::move) to avoid copying text.
+inline JSONObject parseInSitu(std::string text, ParseFlags flags = ParseFlags())
+{
+	_SHARED_PTR_IMPL<std::string> buf(new std::string);
+	buf->swap(text);
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseInSitu(&(*buf)[0], buf->size(), flags, 0, &err);
+	if (cjson)
+		return JSONObject(cjson, buf);
+	else
+		throw JSONError(err);
+}
+
+inline JSONObject parseInSitu(std::string text, const Allocator& alloc, ParseFlags flags = ParseFlags())
+{
+	_SHARED_PTR_IMPL<std::string> buf(new std::string);
+	buf->swap(text);
+	cJSON_Error err;
+	cJSON* cjson = cJSON_ParseInSitu(&(*buf)[0], buf->size(), flags, alloc.get(), &err);
+	if (cjson)
+		return JSONObject(cjson, buf, alloc);
+	alloc.reclaim();
+	throw JSONError(err);
+}
+
+// Base of handlers for parseEvents, which parses into events instead of a document (SAX).
+// Derive Handler from EventHandler<Handler> and define the events of interest with these
+// signatures, the others are ignored. Each returns false to stop the parse. Strings and keys
+// are unescaped but not NUL-terminated, and only valid during the call.
+template <typename Derived>
+struct EventHandler
+{
+	bool null_value() { return true; }
+	bool boolean(bool) { return true; }
+	// numbers other than integers in the int64_t range
+	bool number(double) { return true; }
+	// integers in the int64_t range, exact; passed on to number() unless defined
+	bool integer(int64_t value) { return static_cast<Derived*>(this)->number(static_cast<double>(value)); }
+	bool string(const char*, size_t) { return true; }
+	bool start_object() { return true; }
+	bool key(const char*, size_t) { return true; }
+	bool end_object() { return true; }
+	bool start_array() { return true; }
+	bool end_array() { return true; }
+};
+
+namespace detail {
+
+// cJSON_Handler callbacks calling a handler object. What it throws stops the parse and is
+// rethrown once cJSON_ParseEvents has returned, exceptions must not cross the C code.
+template <typename Handler>
+struct EventCalls
+{
+	Handler* handler;
+	bool stopped;
+#ifdef WITH_CPP11
+	std::exception_ptr error;
+#else
+	bool failed;
+#endif
+
+	template <typename Call>
+	static int call(void* ctx, const Call& event)
+	{
+		EventCalls& self = *static_cast<EventCalls*>(ctx);
+		try {
+			if (event(*self.handler))
+				return 1;
+			self.stopped = true;
+		} catch (...) {
+#ifdef WITH_CPP11
+			self.error = std::current_exception();
+#else
+			self.failed = true;
+#endif
+		}
+		return 0;
+	}
+
+	struct NullValue { bool operator()(Handler& h) const { return h.null_value(); } };
+	struct Boolean { bool v; bool operator()(Handler& h) const { return h.boolean(v); } };
+	struct Number
+	{
+		const cJSON* item;
+		bool operator()(Handler& h) const
+		{
+			if ((item->type & cJSON_Int64) && !(item->type & cJSON_Uint64))
+				return h.integer(item->valueint64);
+			return h.number(item->valuedouble);
+		}
+	};
+	struct String { const char* s; size_t n; bool operator()(Handler& h) const { return h.string(s, n); } };
+	struct Key { const char* s; size_t n; bool operator()(Handler& h) const { return h.key(s, n); } };
+	struct StartObject { bool operator()(Handler& h) const { return h.start_object(); } };
+	struct EndObject { bool operator()(Handler& h) const { return h.end_object(); } };
+	struct StartArray { bool operator()(Handler& h) const { return h.start_array(); } };
+	struct EndArray { bool operator()(Handler& h) const { return h.end_array(); } };
+
+	static int nullValue(void* ctx) { return call(ctx, NullValue()); }
+	static int boolean(void* ctx, int v) { Boolean e = { v != 0 }; return call(ctx, e); }
+	static int number(void* ctx, const cJSON* item) { Number e = { item }; return call(ctx, e); }
+	static int string(void* ctx, const char* s, size_t n) { String e = { s, n }; return call(ctx, e); }
+	static int key(void* ctx, const char* s, size_t n) { Key e = { s, n }; return call(ctx, e); }
+	static int startObject(void* ctx) { return call(ctx, StartObject()); }
+	static int endObject(void* ctx) { return call(ctx, EndObject()); }
+	static int startArray(void* ctx) { return call(ctx, StartArray()); }
+	static int endArray(void* ctx) { return call(ctx, EndArray()); }
+};
+
+} // namespace detail
+
+// parse len bytes of data into events for handler, see EventHandler. Nothing is allocated per
+// value. Returns false if the handler stopped the parse; throws JSONError on malformed input,
+// and what the handler throws
+template <typename Handler>
+bool parseEvents(const char* data, size_t len, Handler& handler, ParseFlags flags = ParseFlags())
+{
+	typedef detail::EventCalls<Handler> Calls;
+	Calls calls;
+	calls.handler = &handler;
+	calls.stopped = false;
+#ifndef WITH_CPP11
+	calls.failed = false;
+#endif
+	cJSON_Handler h = { Calls::nullValue, Calls::boolean, Calls::number, Calls::string,
+						Calls::startObject, Calls::key, Calls::endObject,
+						Calls::startArray, Calls::endArray, &calls };
+	cJSON_Error err;
+	if (cJSON_ParseEvents(data, len, flags, &h, &err))
+		return true;
+#ifdef WITH_CPP11
+	if (calls.error)
+		std::rethrow_exception(calls.error);
+#else
+	if (calls.failed)
+		throw JSONError("Exception in event handler");
+#endif
+	if (calls.stopped)
+		return false;
+	throw JSONError(err);
+}
+
+template <typename Handler>
+inline bool parseEvents(const std::string& str, Handler& handler, ParseFlags flags = ParseFlags())
+{
+	return parseEvents(str.data(), str.size(), handler, flags);
+}
+
+#ifdef WITH_CPP17
+template <typename Handler>
+inline bool parseEvents(std::string_view str, Handler& handler, ParseFlags flags = ParseFlags())
+{
+	return parseEvents(str.data(), str.size(), handler, flags);
+}
+#endif
+
+// what a StreamParser hands out
+enum StreamMode {
+	// each top-level value: concatenated or newline-delimited documents
+	Values,
+	// each element of a top-level array, so a huge array is parsed one element at a time;
+	// other top-level values whole
+	Elements
+};
+
+// Push parser for values arriving in chunks, e.g. from a socket or a pipe. feed() each chunk as
+// it comes: the values it completes are parsed right away and queued for next(). Only the value in
+// progress is kept between chunks, and only its bytes; a value within one chunk is parsed in place.
+// Errors are thrown by feed() or finish(), with the offset in the stream. Not copyable.
+class StreamParser
+{
+	cJSON_Framer framer_;
+	ParseFlags flags_;
+	Allocator* alloc_;
+	// bytes of the value in progress from earlier chunks
+	std::string pending_;
+	bool inValue_;
+	// stream offset of the current chunk, and of the value in progress
+	size_t offset_;
+	size_t valueOffset_;
+	std::deque<JSONObject> ready_;
+
+	void init()
+	{
+		int split = framer_.split;
+		memset(&framer_, 0, sizeof(framer_));
+		framer_.split = split;
+		pending_.clear();
+		inValue_ = false;
+		offset_ = valueOffset_ = 0;
+	}
+
+	void fail(size_t offset, const char* reason)
+	{
+		cJSON_Error err = { offset, 0, 0, reason };
+		throw JSONError(err);
+	}
+
+	void push(const char* data, size_t len)
+	{
+		try {
+			ready_.push_back(alloc_ ? parse(data, len, *alloc_, flags_) : parse(data, len, flags_));
+		} catch (const JSONError& e) {
+			cJSON_Error err = { valueOffset_ + e.offset(), e.line(), e.column(), e.reason() };
+			throw JSONError(err);
+		}
+	}
+
+	explicit StreamParser(const StreamParser&);
+	StreamParser& operator=(const StreamParser&);
+
+public:
+	explicit StreamParser(StreamMode mode = Values, ParseFlags flags = ParseFlags())
+		: flags_(flags), alloc_(NULL)
 	{
+		framer_.split = mode == Elements;
+		init();
 	}
 
-	// create double object
-	explicit JSONObject(double value)
-		: obj_(new Holder(cJSON_CreateNumber(value), true))
+	// parse the values with alloc (or into an Arena)
+	StreamParser(const Allocator& alloc, StreamMode mode = Values, ParseFlags flags = ParseFlags())
+		: flags_(flags), alloc_(new Allocator(alloc))
 	{
+		framer_.split = mode == Elements;
+		init();
 	}
 
-	// create integer object
-	explicit JSONObject(int value)
-		: obj_(new Holder(cJSON_CreateNumber(static_cast<double>(value)), true))
+	~StreamParser()
 	{
+		delete alloc_;
 	}
 
-	// create integer object
-	explicit JSONObject(int64_t value)
-		: obj_(new Holder(cJSON_CreateNumber(static_cast<double>(value)), true))
+	// take the next len bytes of the stream
+	void feed(const char* data, size_t len)
 	{
+		size_t pos = 0, start = 0;
+		while (pos < len) {
+			size_t n;
+			switch (cJSON_Frame(&framer_, data + pos, len - pos, &n)) {
+			case cJSON_FrameBegin:
+				inValue_ = true;
+				start = pos + n;
+				valueOffset_ = offset_ + start;
+				break;
+			case cJSON_FrameEnd:
+				if (pending_.empty()) {
+					push(data + start, pos + n - start);
+				} else {
+					pending_.append(data, pos + n);
+					push(pending_.data(), pending_.size());
+					pending_.clear();
+				}
+				inValue_ = false;
+				break;
+			case cJSON_FrameError:
+				fail(offset_ + pos + n, "unexpected character");
+			}
+			pos += n;
+		}
+		if (inValue_)
+			pending_.append(data + start, len - start);
+		offset_ += len;
 	}
 
-	// create string object
-	explicit JSONObject(const char* value)
-		: obj_(new Holder(cJSON_CreateString(value), true))
+	inline void feed(const std::string& data)
 	{
+		feed(data.data(), data.size());
 	}
 
-	explicit JSONObject(const std::string& value)
-		: obj_(new Holder(cJSON_CreateString(value.c_str()), true))
+	// end of the stream: a number or literal in progress is complete, an open value is an error
+	void finish()
 	{
+		switch (cJSON_FrameFinish(&framer_)) {
+		case cJSON_FrameEnd:
+			push(pending_.data(), pending_.size());
+			init();
+			break;
+		case cJSON_FrameError:
+			fail(offset_, "unexpected end of input");
+			break;
+		default:
+			init();
+		}
 	}
 
-	// create array object
-#ifdef WITH_CPP11
-	template <typename T,
-			  template<typename X, typename A> class ContT=std::vector>
-#else
-	template <typename T,
-			  template<typename X, typename A> class ContT>
-#endif
-	explicit JSONObject(const ContT<T, std::allocator<T> >& elems)
-		: obj_(new Holder(cJSON_CreateArray(), true)),
-		  refs_(new ObjectSet)
+	// start over, e.g. with a new connection or after an error. Queued values are kept
+	void reset()
 	{
-		for (typename ContT<T, std::allocator<T> >::const_iterator it = elems.begin();
-			 it != elems.end(); it++)
-			add(*it);
+		init();
 	}
-#ifdef WITH_CPP11
-	template <typename T>
-	JSONObject(const std::initializer_list<T>& elems)
-		: obj_(new Holder(cJSON_CreateArray(), true)),
-		  refs_(new ObjectSet)
+
+	// take the next parsed value, false if there is none yet
+	bool next(JSONObject& value)
 	{
-		for (auto& it: elems)
-			add(it);
+		if (ready_.empty())
+			return false;
+		value = ready_.front();
+		ready_.pop_front();
+		return true;
 	}
-#endif
-	// for Qt-style containers
-	template <typename T,
-			  template<typename X> class ContT>
-	explicit JSONObject(const ContT<T>& elems)
-		: obj_(new Holder(cJSON_CreateArray(), true)),
-		  refs_(new ObjectSet)
+
+	// number of parsed values waiting for next()
+	inline size_t ready() const { return ready_.size(); }
+};
+
+// Writer of NDJSON (JSON Lines): each document unformatted on a line of its own. Records are
+// printed into one reused buffer and written whole, so writing does not allocate per record.
+class NdjsonWriter
+{
+	std::ostream& os_;
+	std::string line_;
+	size_t count_;
+
+public:
+	explicit NdjsonWriter(std::ostream& os) : os_(os), count_(0) {}
+
+	NdjsonWriter& write(const JSONObject& value)
 	{
-		for (typename ContT<T>::const_iterator it = elems.begin(); it != elems.end(); it++)
-			add(*it);
+		value.print_to(line_, false);
+		line_ += '\n';
+		if (!os_.write(line_.data(), static_cast<std::streamsize>(line_.size())))
+			throw JSONError("Write failed");
+		count_++;
+		return *this;
 	}
 
-	// copy constructor
-	JSONObject(const JSONObject& other)
-		: obj_(other.obj_), refs_(other.refs_)
+	inline NdjsonWriter& operator<<(const JSONObject& value)
 	{
+		return write(value);
 	}
 
-	// copy operator
-	inline JSONObject& operator=(const JSONObject& other)
+	// number of records written
+	inline size_t count() const { return count_; }
+};
+
+#ifndef _WIN32
+// Read-only memory map of a whole file, to parse large inputs without reading them into
+// memory first. Not copyable.
+class MappedFile
+{
+	const char* data_;
+	size_t size_;
+
+	explicit MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+public:
+	explicit MappedFile(const std::string& path) : data_(NULL), size_(0)
 	{
-		if (&other != this) {
-			obj_ = other.obj_;
-			refs_ = other.refs_;
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw JSONError("Cannot open file");
+		struct stat st;
+		bool ok = ::fstat(fd, &st) == 0;
+		if (ok && st.st_size > 0) {
+			void* p = ::mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				data_ = static_cast<const char*>(p);
+				size_ = static_cast<size_t>(st.st_size);
+			} else {
+				ok = false;
+			}
 		}
-		return *this;
+		::close(fd);
+		if (!ok)
+			throw JSONError("Cannot map file");
 	}
 
-	// get object type
-	inline JSONType type() const
+	~MappedFile()
 	{
-		static JSONType vmap[] = {
-			Bool, Bool, Null, Number,
-			String, Array, Object
-		};
-		return vmap[(*obj_)->type & 0xff];
+		if (data_)
+			::munmap(const_cast<char*>(data_), size_);
 	}
 
-	// get value from this object
-	template <typename T>
-	inline T as() const
-	{
-		return as<T>(obj_->o);
-	}
+	inline const char* data() const { return data_; }
+	inline size_t size() const { return size_; }
+};
+#endif
 
-	// get array
 #ifdef WITH_CPP11
-	template <typename T=JSONObject,
-			  template<typename X, typename A> class ContT=std::vector>
-#else
-	template <typename T, template<typename X, typename A> class ContT>
-#endif
-	inline ContT<T, std::allocator<T> > asArray() const
-	{
-		if (((*obj_)->type & 0xff) != cJSON_Array)
-			throw JSONError("Not an array type");
+namespace detail {
 
-		ContT<T, std::allocator<T> > retval;
-		for (int i = 0; i < cJSON_GetArraySize(obj_->o); i++)
-			retval.push_back(as<T>(cJSON_GetArrayItem(obj_->o, i)));
+// a record that failed to parse, located in the whole input: lines are counted from the last
+// located failure (from the start at first), the column is the one in the record's line
+inline cJSON_Error locateRecord(const char* data, size_t begin, const JSONError& e,
+								size_t& counted, int& lines)
+{
+	lines += static_cast<int>(std::count(data + counted, data + begin, '\n'));
+	counted = begin;
+	cJSON_Error err = { begin + e.offset(), lines + 1, e.column(), e.reason() };
+	return err;
+}
 
-		return retval;
-	}
+// end of the line starting at p, and whether it holds anything besides whitespace
+inline size_t lineEnd(const char* data, size_t p, size_t end, bool& blank)
+{
+	const char* nl = static_cast<const char*>(memchr(data + p, '\n', end - p));
+	size_t e = nl ? static_cast<size_t>(nl - data) : end;
+	blank = true;
+	for (size_t i = p; i < e && blank; i++)
+		blank = static_cast<unsigned char>(data[i]) <= ' ';
+	return e;
+}
 
-	// for Qt-style containers
-	template <typename T, template<typename X> class ContT>
-	inline ContT<T> asArray() const
-	{
-		if (((*obj_)->type & 0xff) != cJSON_Array)
-			throw JSONError("Not an array type");
+// start of the line following the first line break at or after p
+inline size_t nextLine(const char* data, size_t p, size_t len)
+{
+	const char* nl = p < len ? static_cast<const char*>(memchr(data + p, '\n', len - p)) : NULL;
+	return nl ? static_cast<size_t>(nl - data) + 1 : len;
+}
 
-		ContT<T> retval;
-		for (int i = 0; i < cJSON_GetArraySize(obj_->o); i++)
-			retval.push_back(as<T>(cJSON_GetArrayItem(obj_->o, i)));
+} // namespace detail
 
-		return retval;
-	}
+// NdjsonReader options
+struct NdjsonOptions
+{
+	// worker threads, 0 for one per core
+	unsigned threads = 0;
+	// hand out values in input order; otherwise batches come out as they are done
+	bool ordered = true;
+	// flags of each record's parse, RequireNullTerminated is implied
+	ParseFlags flags = ParseFlags();
+	// about this many bytes of lines are parsed at a time by one thread
+	size_t batch = 64 * 1024;
+};
 
-	// get object by name
-#ifdef WITH_CPP11
-	template <typename T=JSONObject>
-#else
-	template <typename T>
-#endif
-	inline T get(const char* name) const
+// Reader of NDJSON (JSON Lines): one value per line, as in logs and exports of millions of
+// records. A pool of threads parses batches of lines while next() hands out the values; at most
+// a few batches per thread are held at once. Each batch is parsed into an Arena of its own, so
+// workers do not contend on malloc; its memory goes once all of its records are gone.
+// A bad record throws JSONError from next(), with its offset, line and column in the input,
+// and the next call goes on with the following record. Blank lines are skipped. Not copyable.
+class NdjsonReader
+{
+	struct Record
 	{
-		if (((*obj_)->type & 0xff) != cJSON_Object)
-			throw JSONError("Not an object");
+		JSONObject value;
+		cJSON_Error error;
 
-		cJSON* item = cJSON_GetObjectItem(obj_->o, name);
-		if (item != NULL)
-			return as<T>(item);
-		else
-			throw JSONError("No such item");
-	}
+		// made from the parse result: no empty object is created only to be replaced
+		explicit Record(JSONObject&& parsed) : value(std::move(parsed)) { error.reason = NULL; }
+		explicit Record(const cJSON_Error& err) : value(static_cast<cJSON*>(NULL), false), error(err) {}
+	};
 
-#ifdef WITH_CPP11
-	template <typename T=JSONObject>
-#else
-	template <typename T>
+#ifndef _WIN32
+	std::unique_ptr<MappedFile> file_;
 #endif
-	inline JSONObject get(const std::string& value) const
+	const char* data_;
+	size_t size_;
+	NdjsonOptions opts_;
+	size_t window_;
+
+	std::mutex mutex_;
+	std::condition_variable work_;
+	std::condition_variable done_;
+	// start of the next batch, batches claimed by workers and taken by next()
+	size_t cursor_;
+	size_t claimed_;
+	size_t taken_;
+	bool stop_;
+	std::map<size_t, std::vector<Record> > finished_;
+	std::vector<Record> current_;
+	size_t pos_;
+	std::vector<std::thread> workers_;
+	// lines before offset counted_, so that each failure is located from the previous one
+	size_t counted_;
+	int lines_;
+
+	void start()
 	{
-		return get<T>(value.c_str());
+		opts_.flags = opts_.flags | RequireNullTerminated;
+		unsigned n = opts_.threads ? opts_.threads : std::max(1u, std::thread::hardware_concurrency());
+		window_ = 4 * n;
+		cursor_ = claimed_ = taken_ = pos_ = counted_ = 0;
+		lines_ = 0;
+		stop_ = false;
+		for (unsigned i = 0; i < n; i++)
+			workers_.push_back(std::thread(&NdjsonReader::work, this));
 	}
 
-	inline bool has(const char* name) const
+	void work()
 	{
-		return cJSON_GetObjectItem(obj_->o, name) != NULL;
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			work_.wait(lock, [this] { return stop_ || cursor_ == size_ || claimed_ - taken_ < window_; });
+			if (stop_ || cursor_ == size_)
+				return;
+			size_t index = claimed_++, begin = cursor_;
+			cursor_ = detail::nextLine(data_, std::min(size_, begin + opts_.batch), size_);
+			size_t end = cursor_;
+			lock.unlock();
+			std::vector<Record> records;
+			parseBatch(begin, end, records);
+			lock.lock();
+			finished_[index].swap(records);
+			done_.notify_one();
+		}
 	}
 
-	inline bool has(const std::string& name) const
+	// failures keep their offset only, next() finds their line
+	void parseBatch(size_t begin, size_t end, std::vector<Record>& records)
 	{
-		return has(name.c_str());
+		Arena arena;
+		for (size_t p = begin; p < end; ) {
+			bool blank;
+			size_t e = detail::lineEnd(data_, p, end, blank);
+			if (!blank) {
+				try {
+					records.push_back(Record(parse(data_ + p, e - p, arena, opts_.flags)));
+				} catch (const JSONError& err) {
+					cJSON_Error located = { p + err.offset(), 0, err.column(), err.reason() };
+					records.push_back(Record(located));
+				}
+			}
+			p = e + 1;
+		}
 	}
 
-	// get value from array
-#ifdef WITH_CPP11
-	template <typename T=JSONObject>
-#else
-	template <typename T>
-#endif
-	inline T get(int index) const
+	// line of offset in the input, counted from the last failure located, not from the start
+	int lineAt(size_t offset)
 	{
-		if (((*obj_)->type & 0xff) != cJSON_Array)
-			throw JSONError("Not an array type");
-
-		cJSON* item = cJSON_GetArrayItem(obj_->o, index);
-		if (item != NULL)
-			return as<T>(item);
+		if (offset >= counted_)
+			lines_ += static_cast<int>(std::count(data_ + counted_, data_ + offset, '\n'));
 		else
-			throw JSONError("No such item");
+			lines_ -= static_cast<int>(std::count(data_ + offset, data_ + counted_, '\n'));
+		counted_ = offset;
+		return lines_ + 1;
 	}
 
-	// add value to array
-	template <typename T>
-	inline void add(const T& value)
+	// the next batch to take is done, or there is none left
+	bool available() const
 	{
-		if (((*obj_)->type & 0xff) != cJSON_Array)
-			throw JSONError("Not an array type");
-		JSONObject o(value);
-		cJSON_AddItemReferenceToArray(obj_->o, o.obj_->o);
-		refs_->insert(o);
+		if (opts_.ordered ? finished_.count(taken_) != 0 : !finished_.empty())
+			return true;
+		return taken_ == claimed_ && cursor_ == size_;
 	}
 
-	// set value in object
-	template <typename T>
-	inline void set(const char* name, const T& value) {
-		if (((*obj_)->type & 0xff) != cJSON_Object)
-			throw JSONError("Not an object type");
-		JSONObject o(value);
-		cJSON_AddItemReferenceToObject(obj_->o, name, o.obj_->o);
-		refs_->insert(o);
-	}
+	explicit NdjsonReader(const NdjsonReader&);
+	NdjsonReader& operator=(const NdjsonReader&);
 
-	// set value in object
-	template <typename T>
-	inline void set(const std::string& name, const T& value) {
-		set(name.c_str(), value);
+public:
+	// read len bytes of data, which must outlive the reader
+	NdjsonReader(const char* data, size_t len, const NdjsonOptions& opts = NdjsonOptions())
+		: data_(data), size_(len), opts_(opts)
+	{
+		start();
 	}
 
-	// set value in object (std::string)
-	inline void set(const std::string& name, const JSONObject& value) {
-		return set(name.c_str(), value);
+#ifndef _WIN32
+	// read a file, mapped into memory
+	explicit NdjsonReader(const std::string& path, const NdjsonOptions& opts = NdjsonOptions())
+		: file_(new MappedFile(path)), data_(file_->data()), size_(file_->size()), opts_(opts)
+	{
+		start();
 	}
+#endif
 
-	// remove item from object
-	inline void remove(const char* name) {
-		if (((*obj_)->type & 0xff) != cJSON_Object)
-			throw JSONError("Not an object type");
-		cJSON* detached = cJSON_DetachItemFromObject(obj_->o, name);
-		if (!detached)
-			throw JSONError("No such item");
-		for (ObjectSet::iterator it = refs_->begin(); it != refs_->end(); it++)
-			if (it->obj_->o == detached) {
-				refs_->erase(it);
-				break;
-			}
-		cJSON_Delete(detached);
+	~NdjsonReader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		work_.notify_all();
+		for (size_t i = 0; i < workers_.size(); i++)
+			workers_[i].join();
 	}
 
-	inline void remove(const std::string& name) {
-		return remove(name.c_str());
+	// take the next value, false at the end of the input
+	bool next(JSONObject& value)
+	{
+		for (;;) {
+			if (pos_ < current_.size()) {
+				Record& r = current_[pos_++];
+				if (r.error.reason) {
+					r.error.line = lineAt(r.error.offset);
+					throw JSONError(r.error);
+				}
+				value = std::move(r.value);
+				return true;
+			}
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_.wait(lock, [this] { return available(); });
+			std::map<size_t, std::vector<Record> >::iterator it =
+				opts_.ordered ? finished_.find(taken_) : finished_.begin();
+			if (it == finished_.end())
+				return false;
+			current_.swap(it->second);
+			finished_.erase(it);
+			pos_ = 0;
+			taken_++;
+			work_.notify_one();
+		}
 	}
+};
 
-	// remove item from array
-	inline void remove(int index) {
-		if (((*obj_)->type & 0xff) != cJSON_Array)
-			throw JSONError("Not an array type");
-		cJSON* detached = cJSON_DetachItemFromArray(obj_->o, index);
-		if (!detached)
-			throw JSONError("No such item");
-		for (ObjectSet::iterator it = refs_->begin(); it != refs_->end(); it++)
-			if (it->obj_->o == detached) {
-				refs_->erase(it);
-				break;
+// Parse the records of NDJSON data into events (see parseEvents) on one thread per handler: the
+// input is split into as many runs of whole lines, each fed in order to its own handler, e.g. to
+// combine partial aggregates afterwards. A handler returning false skips the rest of its record.
+// A thread stops at its first bad record; once all are done, the first of these is thrown, with
+// its location in data. Returns the number of records.
+template <typename Handler>
+size_t parseNdjsonEvents(const char* data, size_t len, std::vector<Handler>& handlers,
+						 ParseFlags flags = ParseFlags())
+{
+	size_t n = std::max<size_t>(handlers.size(), 1);
+	std::vector<size_t> counts(n), failed(n, len);
+	std::vector<cJSON_Error> errors(n);
+	std::vector<std::exception_ptr> thrown(n);
+	std::vector<std::thread> threads;
+	size_t begin = 0;
+	for (size_t t = 0; t < handlers.size(); t++) {
+		size_t end = t + 1 == n ? len : std::max(begin, detail::nextLine(data, len / n * (t + 1), len));
+		threads.push_back(std::thread([&, t, begin, end] {
+			size_t counted = 0;
+			int lines = 0;
+			try {
+				for (size_t p = begin; p < end; ) {
+					bool blank;
+					size_t e = detail::lineEnd(data, p, end, blank);
+					if (!blank) {
+						try {
+							parseEvents(data + p, e - p, handlers[t], flags | RequireNullTerminated);
+						} catch (const JSONError& err) {
+							if (err.line() == 0)
+								throw;
+							errors[t] = detail::locateRecord(data, p, err, counted, lines);
+							failed[t] = p;
+							return;
+						}
+						counts[t]++;
+					}
+					p = e + 1;
+				}
+			} catch (...) {
+				thrown[t] = std::current_exception();
 			}
-		cJSON_Delete(detached);
+		}));
+		begin = end;
 	}
+	size_t total = 0, first = n;
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+		total += counts[t];
+		if (failed[t] < len && (first == n || failed[t] < failed[first]))
+			first = t;
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+		if (thrown[t])
+			std::rethrow_exception(thrown[t]);
+	if (first < n)
+		throw JSONError(errors[first]);
+	return total;
+}
+#endif
+
+#ifdef WITH_CPP11
+namespace detail {
+
+// allocator of a document parsed in parts: keeps the arenas of all of them until it dies, items
+// added later come from the first
+class PartsAllocator: public Allocator
+{
+	struct State: public AllocatorState {
+		std::vector<Arena> arenas;
+		explicit State(std::vector<Arena>& parts)
+		{
+			arenas.swap(parts);
+			a = *arenas[0].get();
+		}
+	};
+
+public:
+	explicit PartsAllocator(std::vector<Arena>& parts) : Allocator(new State(parts)) {}
 };
 
-// parse from C string
-inline JSONObject parse(const char* str)
+} // namespace detail
+
+// Parse one large array or object on threads threads (0 for one per core). An index pass
+// matching brackets and quotes splits its elements (members) into runs, which threads parse into
+// arenas of their own; the runs are then linked back into one document. The arenas are released
+// when the last handle on the document dies. Inputs under 64k per thread, other values, and
+// malformed input are parsed on the caller's thread, so errors are those of parse().
+// Lazy is not supported and is ignored.
+inline JSONObject parseParallel(const char* data, size_t len, unsigned threads = 0,
+								ParseFlags flags = ParseFlags())
 {
-	cJSON* cjson = cJSON_Parse(str);
-	if (cjson)
-		return JSONObject(cjson, true);
-	else
-		throw JSONError("Parse error");
+	unsigned n = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	flags = static_cast<ParseFlags>(flags & ~Lazy);
+	std::vector<size_t> splits(4 * n);
+	size_t end = 0, k = 0;
+	if (n > 1 && len / n >= 65536)
+		k = cJSON_SplitContainer(data, len, len / splits.size(), &splits[0], splits.size() - 1, &end);
+	if (k == 0 || k == static_cast<size_t>(-1))
+		return parse(data, len, flags);
+	if (flags & RequireNullTerminated) {
+		for (size_t i = end; i < len && data[i]; i++)
+			if (static_cast<unsigned char>(data[i]) > ' ')
+				return parse(data, len, flags);
+	}
+
+	size_t open = 0;
+	while (data[open] != '[' && data[open] != '{')
+		open++;
+	int type = data[open] == '[' ? cJSON_Array : cJSON_Object;
+	// the index pass matches any closer: a mismatched one is parse()'s error to report
+	if (data[end - 1] != (type == cJSON_Array ? ']' : '}'))
+		return parse(data, len, flags);
+	splits[k] = end - 1;
+	std::vector<cJSON*> parts(k + 1);
+	std::vector<Arena> arenas(n);
+	std::atomic<size_t> next(0);
+	std::atomic<bool> failed(false);
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < n; t++) {
+		workers.push_back(std::thread([&, t] {
+			for (size_t i; !failed && (i = next++) <= k; ) {
+				size_t begin = i ? splits[i - 1] + 1 : open + 1;
+				if (!(parts[i] = cJSON_ParseRun(data + begin, splits[i] - begin, type, flags,
+												arenas[t].get(), NULL)))
+					failed = true;
+			}
+		}));
+	}
+	for (unsigned t = 0; t < n; t++)
+		workers[t].join();
+	if (failed)
+		return parse(data, len, flags);
+
+	cJSON* root = parts[0];
+	int count = 0;
+	for (size_t i = 1; i <= k; i++) {
+		root->tail->next = parts[i]->child;
+		parts[i]->child->prev = root->tail;
+		root->tail = parts[i]->tail;
+	}
+	if (type == cJSON_Object) {
+		for (cJSON* c = root->child; c != NULL && count < cJSON_IndexMinItems; c = c->next)
+			count++;
+		if ((flags & IndexKeys) && count >= cJSON_IndexMinItems)
+			cJSON_IndexObjectWithAllocator(root, arenas[0].get());
+		if (flags & CaseSensitive)
+			root->type |= cJSON_CaseSensitive;
+	}
+	return JSONObject(root, detail::PartsAllocator(arenas));
 }
 
-// parse from std::string
-inline JSONObject parse(const std::string& str)
+inline JSONObject parseParallel(const std::string& str, unsigned threads = 0, ParseFlags flags = ParseFlags())
 {
-	return parse(str.c_str());
+	return parseParallel(str.data(), str.size(), threads, flags);
 }
+#endif
 
 // create null object
 inline JSONObject nullObject()
@@ -422,6 +2507,12 @@ inline JSONObject arrayObject()
 	return JSONObject(cJSON_CreateArray(), true);
 }
 
+// create empty array object with allocator
+inline JSONObject arrayObject(const Allocator& alloc)
+{
+	return JSONObject(cJSON_CreateWithAllocator(cJSON_Array, alloc.get()), alloc);
+}
+
 // Specialized getters
 template <>
 inline int JSONObject::as<int>(cJSON* obj) const
@@ -431,14 +2522,32 @@ inline int JSONObject::as<int>(cJSON* obj) const
 	return obj->valueint;
 }
 
+// exact for integers parsed from text or created from int64_t/uint64_t
 template <>
 inline int64_t JSONObject::as<int64_t>(cJSON* obj) const
 {
 	if ((obj->type & 0xff) != cJSON_Number)
 		throw JSONError("Not a number type");
+	if (obj->type & cJSON_Uint64)
+		throw JSONError("Number out of range");
+	if (obj->type & cJSON_Int64)
+		return obj->valueint64;
 	return static_cast<int64_t>(obj->valuedouble);
 }
 
+template <>
+inline uint64_t JSONObject::as<uint64_t>(cJSON* obj) const
+{
+	if ((obj->type & 0xff) != cJSON_Number)
+		throw JSONError("Not a number type");
+	if ((obj->type & cJSON_Int64) ? obj->valueint64 < 0 && !(obj->type & cJSON_Uint64)
+								   : obj->valuedouble < 0)
+		throw JSONError("Number out of range");
+	if (obj->type & cJSON_Int64)
+		return static_cast<uint64_t>(obj->valueint64);
+	return static_cast<uint64_t>(obj->valuedouble);
+}
+
 template <>
 inline std::string JSONObject::as<std::string>(cJSON* obj) const
 {
@@ -447,6 +2556,26 @@ inline std::string JSONObject::as<std::string>(cJSON* obj) const
 	return obj->valuestring;
 }
 
+// no copy: points into the document and stays valid while it is alive and the value is not replaced
+template <>
+inline const char* JSONObject::as<const char*>(cJSON* obj) const
+{
+	if ((obj->type & 0xff) != cJSON_String)
+		throw JSONError("Not a string type");
+	return obj->valuestring;
+}
+
+#ifdef WITH_CPP17
+// no copy, as as<const char*>
+template <>
+inline std::string_view JSONObject::as<std::string_view>(cJSON* obj) const
+{
+	if ((obj->type & 0xff) != cJSON_String)
+		throw JSONError("Not a string type");
+	return obj->valuestring;
+}
+#endif
+
 template <>
 inline double JSONObject::as<double>(cJSON* obj) const
 {
@@ -472,10 +2601,29 @@ inline JSONObject JSONObject::as<JSONObject>(cJSON* obj) const
 	return JSONObject(*this, obj, false);
 }
 
+// a view shares the handle of the object it came from, nothing is allocated
+template <>
+inline JSONView JSONObject::as<JSONView>(cJSON* obj) const
+{
+	return JSONView(*this, obj);
+}
+
+inline JSONObject JSONObject::const_iterator::operator*() const
+{
+	return parent_->as<JSONObject>(cur_);
+}
+
+inline JSONView JSONObject::view() const
+{
+	return JSONView(*this, obj_->o);
+}
+
 // A traditional C++ streamer
 inline std::ostream& operator<<(std::ostream& os, const cjsonpp::JSONObject& obj)
 {
-	os << obj.print();
+	cJSON_Sink sink = { detail::writeToStream, &os };
+	if (cJSON_PrintToSink(obj.obj(), 1, &sink, 0) == static_cast<size_t>(-1))
+		os.setstate(std::ios_base::failbit);
 	return os;
 }
 
@@ -484,7 +2632,7 @@ inline std::ostream& operator<<(std::ostream& os, const cjsonpp::JSONObject& obj
 template<class T, class TOutputIterator>
 void asArray(const JSONObject &data, TOutputIterator output)
 {
-	cJSON *current = cJSON_GetArrayItem(data.obj(), 0);
+	cJSON *current = cJSON_GetArrayItem(data.node(), 0);
 	while (current) {
 		*output = JSONObject(current, false);
 
@@ -1,8 +1,94 @@
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <list>
+#include <iterator>
+#include <sstream>
 #include "cjsonpp.h"
 
+// allocator counting live blocks
+struct CountingPool
+{
+	int live;
+	CountingPool() : live(0) {}
+	void* allocate(size_t sz) { live++; return malloc(sz); }
+	void deallocate(void* ptr) { live--; free(ptr); }
+};
+
+// print_chunks callback collecting output, refusing after limit chunks
+struct ChunkCollector
+{
+	std::string* out;
+	int chunks, limit;
+	bool operator()(const char* data, size_t len)
+	{
+		out->append(data, len);
+		return ++chunks <= limit;
+	}
+};
+
+// parses s from an exact-size copy without NUL terminator, returns the error reason or ""
+std::string parseUnterminated(const char* s)
+{
+	size_t len = strlen(s);
+	char* buf = new char[len];
+	memcpy(buf, s, len);
+	std::string reason;
+	try {
+		cjsonpp::parse(buf, len);
+	} catch (const cjsonpp::JSONError& e) {
+		reason = e.reason();
+	}
+	delete[] buf;
+	return reason;
+}
+
+// feeds text to a StreamParser in chunks of chunk bytes, returns the values printed on one line
+std::string streamed(const std::string& text, size_t chunk, cjsonpp::StreamMode mode)
+{
+	cjsonpp::StreamParser parser(mode);
+	std::string out;
+	cjsonpp::JSONObject value;
+	for (size_t i = 0; i < text.size(); i += chunk) {
+		parser.feed(text.data() + i, std::min(chunk, text.size() - i));
+		while (parser.next(value))
+			out += value.print(false) + " ";
+	}
+	parser.finish();
+	while (parser.next(value))
+		out += value.print(false) + " ";
+	return out;
+}
+
+// parseEvents handler listing the events, stopping after limit of them
+struct EventLog: cjsonpp::EventHandler<EventLog>
+{
+	std::string out;
+	int limit;
+	EventLog() : limit(-1) {}
+	bool add(const std::string& token) { out += token + " "; return --limit != 0; }
+	bool null_value() { return add("null"); }
+	bool boolean(bool value) { return add(value ? "true" : "false"); }
+	bool number(double value) { std::ostringstream os; os << value; return add(os.str()); }
+	bool integer(int64_t value) { std::ostringstream os; os << "i" << value; return add(os.str()); }
+	bool string(const char* str, size_t len) { return add("\"" + std::string(str, len)); }
+	bool key(const char* str, size_t len) { return add(std::string(str, len) + ":"); }
+	bool start_object() { return add("{"); }
+	bool end_object() { return add("}"); }
+	bool start_array() { return add("["); }
+	bool end_array() { return add("]"); }
+};
+
+// parseEvents handler summing numbers, integers included
+struct NumberSum: cjsonpp::EventHandler<NumberSum>
+{
+	double total;
+	NumberSum() : total(0) {}
+	bool number(double value) { total += value; return true; }
+	bool string(const char*, size_t) { throw cjsonpp::JSONError("No strings"); }
+};
+
 cjsonpp::JSONObject create_arr()
 {
 	cjsonpp::JSONObject obj;
@@ -15,6 +101,16 @@ cjsonpp::JSONObject create_arr()
 	return obj.get<cjsonpp::JSONObject>("arr");
 }
 
+#ifdef WITH_CPP11
+// whether JSONObject::print_to(A, B) compiles
+template <typename A, typename B, typename = void>
+struct PrintsTo: std::false_type {};
+
+template <typename A, typename B>
+struct PrintsTo<A, B, decltype(void(std::declval<const cjsonpp::JSONObject&>().print_to(std::declval<A>(), std::declval<B>())))>
+	: std::true_type {};
+#endif
+
 int main()
 {
 	using namespace cjsonpp;
@@ -73,6 +169,759 @@ int main()
 		const std::string json = arr3.print();
 		std::cout << json << std::endl;
 
+		// iterator walks the elements in order
+		JSONObject nums = parse("[10, 20, 30, 40]");
+		int expected = 10;
+		for (JSONObject::const_iterator it = nums.begin(); it != nums.end(); ++it, expected += 10)
+			assert(it.as<int>() == expected && (*it).as<int>() == expected);
+		assert(expected == 50 && nums.size() == 4);
+
+		// appends after removing the last element keep the chain consistent
+		nums.remove(3);
+		nums.add(50);
+		nums.add(60);
+		assert(nums.size() == 5 && nums.get<int>(3) == 50 && nums.get<int>(4) == 60);
+		assert(nums.obj()->tail == nums.obj()->child->next->next->next->next);
+
+		// indexed lookups agree with the linear scan across edits
+		JSONObject big;
+		big.indexKeys();
+		for (int i = 0; i < 100; i++) {
+			char key[16];
+			snprintf(key, sizeof(key), "Key%d", i);
+			big.set(key, i);
+		}
+		assert(big.get<int>("key42") == 42 && big.has("KEY99"));
+		big.remove("key42");
+		assert(!big.has("key42") && big.get<int>("key43") == 43);
+		big.set("key43", 1000);	// duplicate key, the first one wins
+		assert(big.get<int>("key43") == 43);
+		big.remove("key43");
+		assert(big.get<int>("key43") == 1000 && big.size() == 99);
+		JSONObject parsed = parse(big.print(false), IndexKeys);
+		assert(parsed.obj()->type & cJSON_Indexed);
+		assert(parsed.get<int>("key0") == 0 && parsed.get<int>("key43") == 1000);
+
+		// exact key matching, with and without index
+		JSONObject ids = parse("{\"Id\": 1, \"id\": 2}", CaseSensitive);
+		assert(ids.get<int>("id") == 2 && ids.get<int>(std::string("Id")) == 1 && !ids.has("ID"));
+		assert(cJSON_GetObjectItemCaseSensitive(o.obj(), "NUM") == NULL);
+		assert(o.get<int>("NUM") == 1234 && o.get<int>("numeric", 3) == 1234);
+		ids.indexKeys();
+		assert(ids.get<int>("id") == 2 && ids.get<int>("Id") == 1 && !ids.has("ID"));
+		big.caseSensitiveKeys();
+		assert(big.has("Key1") && !big.has("key1"));
+
+		// arena documents are released together and are read-only
+		Arena arena(256);
+		{
+			JSONObject doc1 = parse(o.print(), arena);
+			JSONObject doc2 = parse(parsed.print(), arena, IndexKeys);
+			std::vector<int> dv = doc1.get<JSONObject>("v").asArray<int, std::vector>();
+			assert(dv == v && doc2.get<int>("KEY0") == 0);
+			doc1 = JSONObject();
+			assert(doc2.get<int>("key99") == 99);
+			JSONObject doc3 = parse("{\"v\": [1]}", arena);
+			doc3.get<JSONObject>("v").remove(0);
+			doc3.set("w", v);
+			doc3.indexKeys();
+			assert(doc3.print(false) == "{\"v\":[],\"w\":[1,2,3,4]}");
+		}
+		try {
+			parse("[1, 2", arena);
+			assert(false);
+		} catch (const JSONError&) {
+		}
+		assert(parse("{\"a\": \"b\"}", arena).get<std::string>("a") == "b");
+
+		// documents free their items with the allocator they came from
+		{
+			CountingPool pool;
+			Allocator alloc = Allocator::forPool(pool);
+			{
+				JSONObject doc = parse(o.print(), alloc);
+				doc.set("extra", v);
+				doc.remove("str1");
+				JSONObject arr = arrayObject(alloc);
+				arr.add(doc.get<JSONObject>("v"));
+				std::vector<int> pv = parse(doc.print()).get<JSONObject>("v").asArray<int, std::vector>();
+				assert(pv == v);
+				assert(pool.live > 0);
+			}
+			assert(pool.live == 0);
+		}
+
+		// parse errors carry their location
+		try {
+			parse("{\n  \"a\": 1,\n  \"b\" 2\n}");
+			assert(false);
+		} catch (const JSONError& e) {
+			assert(e.line() == 3 && e.column() == 7);
+			assert(e.offset() == 18);
+			assert(std::string(e.reason()) == "expected ':'");
+		}
+		try {
+			parse("[1, 2] x", RequireNullTerminated);
+			assert(false);
+		} catch (const JSONError& e) {
+			assert(e.offset() == 7);
+			assert(std::string(e.reason()) == "unexpected data after value");
+		}
+		assert(parse("[1, 2] x").size() == 2);
+		assert(cJSON_ParseWithError("\"abc", 0, 0, 0) == 0);
+
+		// length-bounded parsing never reads past the end
+		assert(parse("[1, 2, 3] trailing", 9).size() == 3);
+		assert(parse("{\"a\": 1}xx", 8, RequireNullTerminated).get<int>("a") == 1);
+		assert(parseUnterminated("{\"a\": [true, null, -1.5e2]}") == "");
+		assert(parseUnterminated("12") == "");
+		assert(parseUnterminated("{\"a\": \"b") == "unterminated string");
+		assert(parseUnterminated("[\"\\") == "unterminated string");
+		assert(parseUnterminated("[tru") == "unexpected character");
+		assert(parseUnterminated("[1,") == "unexpected end of input");
+		assert(parseUnterminated("\"\\u12\"") == "");
+		assert(parse(std::string("[\"a\\u0041\"]\0[", 13), RequireNullTerminated).size() == 1);
+
+
+		// strings and whitespace runs across the vector widths, up to the end of the input
+		for (size_t n = 0; n < 70; n++) {
+			std::string body(n, 'a');
+			std::string padded = std::string(n, ' ') + "[\"" + body + "\"" + std::string(n, '\n') + "]";
+			assert(parse(padded).get<std::string>(0) == body);
+			std::string escaped = "\"" + body + "\\\"" + body + "\\n\"";
+			assert(parse(escaped).as<std::string>() == body + '"' + body + '\n');
+			assert(parseUnterminated(("\"" + body).c_str()) == "unterminated string");
+			assert(parseUnterminated(("[" + std::string(n, '\t')).c_str()) == "unexpected end of input");
+		}
+
+		// in-situ parsing: strings point into the input, unescaped in place
+		{
+			char text[] = "{\"name\": \"plain\", \"esc\\u0041ped\": \"a\\tb\\u00e9\", \"list\": [\"x\", 1]}";
+			JSONObject doc = parseInSitu(text, sizeof(text) - 1);
+			const char* name = doc.get<const char*>("name");
+			assert(name >= text && name < text + sizeof(text) && std::string(name) == "plain");
+			assert(doc.get<std::string>("escAped") == "a\tb\xc3\xa9");
+			assert(doc.get<JSONObject>("list").get<std::string>(0) == "x");
+			JSONObject copy(cJSON_Duplicate(doc.obj(), 1), true);
+			doc.remove("name");
+			assert(copy.get<std::string>("name") == "plain" && copy.print() == parse(copy.print()).print());
+
+			Arena arena;
+			JSONObject kept = parseInSitu(std::string("[\"kept\", {\"k\": \"v\"}]"), arena);
+			JSONObject inner = kept.get<JSONObject>(1);
+			kept = JSONObject();
+			assert(std::string(inner.get<const char*>("k")) == "v");
+#ifdef WITH_CPP17
+			assert(inner.get<std::string_view>("k") == "v");
+#endif
+			char bad[] = "{\"a\": \"b\", \"c\" 1}";
+			bool thrown = false;
+			try {
+				parseInSitu(bad, sizeof(bad) - 1);
+			} catch (const JSONError& e) {
+				thrown = std::string(e.reason()) == "expected ':'";
+			}
+			assert(thrown);
+		}
+
+		// lazy parsing: nested values are parsed when first touched
+		{
+			std::string envelope = "{\"header\": {\"route\": \"a\", \"id\": 7}, "
+				"\"body\": {\"big\": [1, 2.50, {\"x\": \"]}\\\"\"}], \"s\": \"{[\"}, \"tail\": [1, 2]}";
+			JSONObject doc = parse(envelope, Lazy);
+			cJSON* body = cJSON_GetObjectItem(doc.obj(), "body");
+			assert((body->type & cJSON_Lazy) && body->child == NULL);
+			assert(doc.get<JSONObject>("header").get<std::string>("route") == "a");
+			std::vector<int> tail = doc.get<JSONObject>("tail").asArray<int, std::vector>();
+			assert(tail.size() == 2);
+			// untouched values print as their input
+			assert(doc.print(false).find("\"body\":{\"big\": [1, 2.50,") != std::string::npos);
+			assert(parse(doc.print()).print() == parse(envelope).print());
+			JSONObject copy(cJSON_Duplicate(doc.obj(), 1), true);
+			assert(copy.print() == parse(envelope).print());
+			assert(doc.get<JSONObject>("body").get<JSONObject>("big").get<JSONObject>(2).get<std::string>("x") == "]}\"");
+			assert(!(body->type & cJSON_Lazy));
+
+			// nested text is checked when it is expanded
+			Arena arena;
+			JSONObject bad = parse("[1, {\"a\" 1}, [}]", arena, Lazy);
+			assert(bad.size() == 3);
+			bool thrown = false;
+			try {
+				bad.get<JSONObject>(1).get<int>("a");
+			} catch (const JSONError& e) {
+				thrown = std::string(e.reason()) == "expected ':'" && e.offset() == 5;
+			}
+			assert(thrown);
+			thrown = false;
+			try {
+				parse("{\"a\": [1, \"]\"", Lazy);
+			} catch (const JSONError& e) {
+				thrown = std::string(e.reason()) == "unexpected end of input";
+			}
+			assert(thrown);
+		}
+
+		// JSON pointers (the RFC 6901 examples)
+		{
+			JSONObject doc = parse("{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, "
+				"\"e^f\": 3, \"g|h\": 4, \"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8, \"FOO\": 9}");
+			assert(doc.at<JSONObject>("").obj() == doc.obj());
+			assert(doc.at<JSONObject>("/foo").size() == 2);
+			assert(doc.at<std::string>("/foo/0") == "bar");
+			assert(doc.at<int>("/") == 0);
+			assert(doc.at<int>("/a~1b") == 1);
+			assert(doc.at<int>("/c%d") == 2);
+			assert(doc.at<int>("/i\\j") == 5);
+			assert(doc.at<int>("/k\"l") == 6);
+			assert(doc.at<int>("/ ") == 7);
+			assert(doc.at<int>("/m~0n") == 8);
+			assert(doc.at<int>(std::string("/FOO")) == 9);
+
+			CompiledPath second("/foo/1");
+			assert(second.size() == 2 && second.str() == "/foo/1");
+			assert(doc.at<std::string>(second) == "baz");
+			assert(doc.has(second));
+			assert(!doc.has(CompiledPath("/foo/-")));
+			assert(!doc.has(CompiledPath("/foo/01")));
+			assert(!doc.has(CompiledPath("/foo/2")));
+			assert(!doc.has(CompiledPath("/foo/0/x")));
+			bool thrown = false;
+			try {
+				doc.at<int>("/nope");
+			} catch (const JSONError& e) {
+				thrown = std::string(e.what()) == "No such item";
+			}
+			assert(thrown);
+			thrown = false;
+			try {
+				CompiledPath bad("/a~2");
+			} catch (const JSONError&) {
+				thrown = true;
+			}
+			assert(thrown);
+
+			// one compiled path over many documents, lazy ones are expanded on the way
+			CompiledPath id("/header/ids/1");
+			for (int i = 0; i < 3; i++) {
+				std::ostringstream msg;
+				msg << "{\"header\": {\"ids\": [0, " << i << "]}, \"body\": [[]]}";
+				assert(parse(msg.str(), Lazy).at<int>(id) == i);
+			}
+		}
+
+		// views keep the document alive and navigate it without wrapping each child
+		{
+			JSONView items = parse("{\"items\": [{\"n\": 1}, {\"n\": 2}, {\"n\": 3}], \"s\": \"x\"}", Lazy)
+				.get<JSONView>("items");
+			assert(items.size() == 3 && items.get<JSONView>(1).get<int>("n") == 2);
+			int n = 0;
+			for (JSONView::const_iterator it = items.begin(); it != items.end(); ++it)
+				n += (*it).get<int>("n") + it.as<JSONView>().at<int>("/n");
+			assert(n == 12);
+			std::vector<JSONView> all = items.asArray<JSONView, std::vector>();
+			assert(all.size() == 3 && all[2].get<int>(std::string("n")) == 3);
+			assert(items.print(false) == "[{\"n\":1},{\"n\":2},{\"n\":3}]");
+			assert(items.printed_length(false) == 25);
+
+			JSONObject doc = parse("{\"a\": {\"b\": [true]}}");
+			JSONView b = doc.view().get<JSONView>("a").get<JSONView>("b");
+			assert(b.get<bool>(0) && doc.at<JSONView>("/a/b/0").as<bool>());
+			JSONObject editable = b.as<JSONObject>();
+			editable.add(false);
+			assert(doc.print(false) == "{\"a\":{\"b\":[true,false]}}");
+			assert(doc.get<JSONObject>("a").begin().as<JSONView>().size() == 2);
+		}
+
+		// values are moved into the tree unless another handle shares them
+		{
+			JSONObject shared = parse("[1]");
+			JSONObject tree;
+			tree.set("n", 5);
+			tree.set("s", std::string("x"));
+			tree.set("v", v);
+			tree.set("shared", shared);
+			cJSON* n = cJSON_GetObjectItem(tree.obj(), "n");
+			assert(!(n->type & cJSON_IsReference) && !(cJSON_GetObjectItem(tree.obj(), "v")->type & cJSON_IsReference));
+			assert(cJSON_GetObjectItem(tree.obj(), "shared")->type & cJSON_IsReference);
+#ifdef WITH_CPP11
+			JSONObject moved = parse("{\"k\": [true]}");
+			tree.set("moved", std::move(moved));
+			assert(!(cJSON_GetObjectItem(tree.obj(), "moved")->type & cJSON_IsReference));
+			assert(tree.at<bool>("/moved/k/0"));
+			JSONObject list = arrayObject();
+			list.add(parse("{}"));
+			assert(list.obj()->child && !(list.obj()->child->type & cJSON_IsReference));
+#endif
+			assert(tree.print(false).find("\"n\":5,\"s\":\"x\",\"v\":[1,2,3,4],\"shared\":[1]") != std::string::npos);
+
+			// removing a shared value releases the tree's hold on it
+			CountingPool pool;
+			{
+				JSONObject pooled = arrayObject(Allocator::forPool(pool));
+				pooled.add(1);
+				tree.set("pooled", pooled);
+			}
+			assert(pool.live > 0);
+			tree.remove("pooled");
+			assert(pool.live == 0);
+
+			// scalars are copied into an arena tree, containers from elsewhere are referenced
+			Arena scratch;
+			JSONObject doc = parse("[]", scratch);
+			doc.add(int64_t(-7));
+			doc.add("s");
+			doc.add(v);
+			assert(!(doc.obj()->child->type & cJSON_IsReference) && (doc.obj()->tail->type & cJSON_IsReference));
+			assert(doc.print(false) == "[-7,\"s\",[1,2,3,4]]");
+			doc.remove(2);
+			doc.remove(0);
+			assert(doc.print(false) == "[\"s\"]");
+
+			// containers created in place, with the tree's allocator
+			JSONObject rec = doc.emplaceObject();
+			rec.set("id", UINT64_MAX);
+			rec.set(std::string("name"), std::string("n"));
+			JSONObject tags = rec.emplaceArray("tags");
+			tags.add(std::string("t"));
+			tags.emplaceArray();
+			assert(!(doc.obj()->tail->type & cJSON_IsReference) && !(tags.obj()->type & cJSON_IsReference));
+			assert(doc.print(false) == "[\"s\",{\"id\":18446744073709551615,\"name\":\"n\",\"tags\":[\"t\",[]]}]");
+			bool thrown = false;
+			try {
+				rec.emplaceArray();
+			} catch (const JSONError&) {
+				thrown = true;
+			}
+			assert(thrown);
+
+			// a shared value set through an emplaced handle outlives the handle
+			JSONObject holder = parse("{}");
+			{
+				JSONObject shared = parse("{\"a\": [1]}");
+				JSONObject inner = holder.emplaceObject("rec");
+				inner.set("s", shared);
+			}
+			assert(holder.print(false) == "{\"rec\":{\"s\":{\"a\":[1]}}}");
+			holder.get<JSONObject>("rec").remove("s");
+			assert(holder.print(false) == "{\"rec\":{}}");
+		}
+#ifdef WITH_CPP11
+		// moves hand over the handle without touching reference counts
+		{
+			JSONObject a = parse("[1]");
+			cJSON* item = a.obj();
+			JSONObject b(std::move(a));
+			assert(b.obj() == item);
+			a = std::move(b);
+			assert(a.obj() == item && a.size() == 1);
+			std::vector<JSONObject> stash;
+			stash.push_back(std::move(a));
+			stash.push_back(parse("{}"));
+			assert(stash[0].obj() == item);
+		}
+#endif
+#ifdef WITH_CPP11
+		// NDJSON: records parsed by a pool of threads come out in order, a bad one throws in place
+		{
+			std::ostringstream os;
+			NdjsonWriter writer(os);
+			for (int i = 0; i < 2000; i++) {
+				JSONObject rec;
+				rec.set("i", i);
+				writer << rec;
+			}
+			assert(writer.count() == 2000 && os.str().compare(0, 16, "{\"i\":0}\n{\"i\":1}\n") == 0);
+			std::string text = os.str().insert(8, "\n  \r\n").insert(0, "{\"i\" -1}\r\n") + "[1] 2\n";
+			NdjsonOptions opts;
+			opts.threads = 3;
+			opts.batch = 64;
+			NdjsonReader ordered(text.data(), text.size(), opts);
+			JSONObject rec;
+			int line = 0;
+			try {
+				ordered.next(rec);
+			} catch (const JSONError& e) {
+				line = e.line();
+			}
+			assert(line == 1);
+			for (int i = 0; i < 2000; i++)
+				assert(ordered.next(rec) && rec.get<int>("i") == i);
+			try {
+				ordered.next(rec);
+			} catch (const JSONError& e) {
+				line = e.line();
+				assert(e.offset() == text.size() - 2 && e.column() == 5);
+			}
+			assert(line == 2004);
+			assert(!ordered.next(rec) && !ordered.next(rec));
+
+			opts.ordered = false;
+			opts.threads = 0;
+			NdjsonReader unordered(text.data() + 10, text.size() - 16, opts);
+			long sum = 0, count = 0;
+			while (unordered.next(rec)) {
+				sum += rec.get<int>("i");
+				count++;
+			}
+			assert(count == 2000 && sum == 1999000);
+			// every bad line is located, whichever order the batches finish in
+			std::string scattered;
+			for (int i = 0; i < 3000; i++)
+				scattered += i % 97 == 5 ? "{\"i\" 1}\n" : "{\"i\": 1}\n";
+			opts.threads = 4;
+			NdjsonReader failing(scattered.data(), scattered.size(), opts);
+			int failures = 0;
+			for (;;) {
+				try {
+					if (!failing.next(rec))
+						break;
+				} catch (const JSONError& e) {
+					long before = std::count(scattered.begin(), scattered.begin() + e.offset(), '\n');
+					assert(e.line() == before + 1 && before % 97 == 5);
+					failures++;
+				}
+			}
+			assert(failures == 31);
+
+			// records of one batch share its arena, and may be dropped on different threads
+			{
+				NdjsonReader one(text.data() + 10, text.size() - 16);
+				std::vector<JSONObject> shares[8];
+				for (int i = 0; one.next(rec); i++)
+					shares[i % 8].push_back(rec);
+				rec = JSONObject();
+				std::vector<std::thread> owners;
+				long sums[8] = {};
+				for (int t = 0; t < 8; t++)
+					owners.push_back(std::thread([&shares, &sums, t] {
+						for (size_t i = 0; i < shares[t].size(); i++)
+							sums[t] += shares[t][i].get<int>("i");
+						shares[t].clear();
+					}));
+				for (int t = 0; t < 8; t++)
+					owners[t].join();
+				long total = 0;
+				for (int t = 0; t < 8; t++)
+					total += sums[t];
+				assert(total == 1999000);
+			}
+
+			char path[] = "/tmp/cjsonppXXXXXX";
+			int fd = mkstemp(path);
+			assert(fd >= 0 && write(fd, text.data() + 10, 30) == 30);
+			close(fd);
+			NdjsonReader file(path);
+			assert(file.next(rec) && rec.get<int>("i") == 0 && file.next(rec) && rec.get<int>("i") == 1);
+			unlink(path);
+
+			// events on three threads, a handler each: together they see every record once
+			std::vector<NumberSum> sums(3);
+			assert(parseNdjsonEvents(text.data() + 10, text.size() - 16, sums) == 2000);
+			assert(sums[0].total + sums[1].total + sums[2].total == 1999000);
+			line = 0;
+			try {
+				parseNdjsonEvents(text.data(), text.size(), sums);
+			} catch (const JSONError& e) {
+				line = e.line();
+			}
+			assert(line == 1);
+		}
+#endif
+
+#ifdef WITH_CPP11
+		// a large array or object parsed in runs on several threads is the one parse() builds
+		{
+			std::string arr = "[", obj = "{";
+			for (int i = 0; i < 5000; i++) {
+				std::ostringstream rec;
+				rec << (i ? ", " : "") << "{\"id\": " << i << ", \"s\": \"a,]}\\\"[\", \"n\": [1, [2]]}";
+				arr += rec.str();
+				obj += (i ? ", \"k" : "\"k") + std::to_string(i) + "\": " + rec.str().substr(i ? 2 : 0);
+			}
+			arr += "]\n";
+			obj += "}";
+			JSONObject whole = parseParallel(arr, 3);
+			assert(whole.print(false) == parse(arr).print(false) && whole.size() == 5000);
+			whole.add(5000);
+			assert(whole.get<int>(5000) == 5000 && whole.get<JSONObject>(4999).get<int>("id") == 4999);
+			JSONObject members = parseParallel(obj, 4, IndexKeys | CaseSensitive);
+			assert(members.size() == 5000 && members.get<JSONObject>("k4321").get<int>("id") == 4321 && !members.has("K4321"));
+			assert((members.obj()->type & cJSON_Indexed) && members.print() == parse(obj).print());
+			assert(parseParallel(std::string("[1, 2]"), 4).size() == 2);
+
+			std::string bad[] = { arr.substr(0, arr.size() - 2) + ",]", arr.substr(0, arr.size() - 2) + "}",
+				obj.substr(0, obj.size() - 1) + "]" };
+			for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+				std::string treeReason, parallelReason;
+				size_t treeOffset = 0, parallelOffset = 1;
+				try {
+					parse(bad[i]);
+				} catch (const JSONError& e) {
+					treeReason = e.reason();
+					treeOffset = e.offset();
+				}
+				try {
+					parseParallel(bad[i], 3);
+				} catch (const JSONError& e) {
+					parallelReason = e.reason();
+					parallelOffset = e.offset();
+				}
+				assert(!treeReason.empty() && treeReason == parallelReason && treeOffset == parallelOffset);
+			}
+			bool thrown = false;
+			try {
+				parseParallel(arr + "x", 3, RequireNullTerminated);
+			} catch (const JSONError& e) {
+				thrown = e.offset() == arr.size();
+			}
+			assert(thrown);
+		}
+#endif
+
+		// events follow the grammar of the tree parser: exact integers, unescaped strings
+		{
+			EventLog log;
+			std::string text = "{\"a\": [1, -2.5, \"x\\ty\", null], \"b\\u00e9\": {},\n"
+				"\"c\": [true, false, 9007199254740993, 18446744073709551615]}";
+			assert(parseEvents(text, log));
+			assert(log.out == "{ a: [ i1 -2.5 \"x\ty null ] b\xc3\xa9: { } c: [ true false i9007199254740993 1.84467e+19 ] } ");
+			EventLog stopped;
+			stopped.limit = 4;
+			assert(!parseEvents(text, stopped));
+			assert(stopped.out == "{ a: [ i1 ");
+			NumberSum sum;
+			assert(parseEvents(std::string("[1, 2.5, {\"n\": 3}, []]"), sum) && sum.total == 6.5);
+			bool thrown = false;
+			try {
+				parseEvents(std::string("[1, \"s\"]"), sum);
+			} catch (const JSONError&) {
+				thrown = sum.total == 7.5;
+			}
+			assert(thrown);
+
+			// malformed input fails where the tree parser fails, for the same reason
+			const char* bad[] = { "[1, 2", "{\"a\" 1}", "{\"a\": 1,}", "[1 2]", "\"open", "[tru]", "", "{1: 2}", "[-]", "[1.]", "[1e]" };
+			for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+				std::string treeReason, eventReason;
+				size_t treeOffset = 0, eventOffset = 1;
+				try {
+					parse(bad[i], strlen(bad[i]));
+				} catch (const JSONError& e) {
+					treeReason = e.reason();
+					treeOffset = e.offset();
+				}
+				try {
+					parseEvents(std::string(bad[i]), log);
+				} catch (const JSONError& e) {
+					eventReason = e.reason();
+					eventOffset = e.offset();
+				}
+				assert(!treeReason.empty() && treeReason == eventReason && treeOffset == eventOffset);
+			}
+			// a number that fails to parse is never delivered
+			NumberSum none;
+			try {
+				parseEvents(std::string("[1.]"), none);
+			} catch (const JSONError&) {
+			}
+			assert(none.total == 0);
+			thrown = false;
+			try {
+				parseEvents(std::string("[1] 2"), log, RequireNullTerminated);
+			} catch (const JSONError& e) {
+				thrown = e.offset() == 4;
+			}
+			assert(thrown);
+		}
+
+		// values arriving in chunks come out the same wherever the chunks split them
+		{
+			std::string text = " {\"a\": [1, \"x]\\\"\\\\\"]}\n-12.5e1 \"s\\\"\" [true, {}]\ntrue";
+			std::string values = "{\"a\":[1,\"x]\\\"\\\\\"]} -125 \"s\\\"\" [true,{}] true ";
+			std::string items = "[1, {\"b\": [2, 3]}, \"]\", []] 4 [ ]";
+			for (size_t chunk = 1; chunk <= text.size(); chunk++)
+				assert(streamed(text, chunk, Values) == values);
+			for (size_t chunk = 1; chunk <= items.size(); chunk++)
+				assert(streamed(items, chunk, Elements) == "1 {\"b\":[2,3]} \"]\" [] 4 ");
+			// elements need exactly one ',' between them, as parse() does
+			const char* badItems[] = { "[1 2]", "[,1]", "[1,]", "[1,,2]", "[{} []]" };
+			for (size_t i = 0; i < sizeof(badItems) / sizeof(badItems[0]); i++) {
+				for (size_t chunk = 1; chunk <= 2; chunk++) {
+					bool rejected = false;
+					try {
+						streamed(badItems[i], chunk, Elements);
+					} catch (const JSONError&) {
+						rejected = true;
+					}
+					assert(rejected);
+				}
+			}
+
+			StreamParser parser(arena, Elements, Lazy);
+			parser.feed("[{\"id\": 1}, {\"id\": 2}, ");
+			assert(parser.ready() == 2);
+			JSONObject first;
+			assert(parser.next(first) && first.get<int>("id") == 1);
+			bool thrown = false;
+			try {
+				parser.feed("{\"id\" 3}]");
+			} catch (const JSONError& e) {
+				thrown = std::string(e.reason()) == "expected ':'" && e.offset() == 29;
+			}
+			assert(thrown);
+			parser.reset();
+			parser.feed(std::string("[5] {\"open\": ["));
+			thrown = false;
+			try {
+				parser.finish();
+			} catch (const JSONError& e) {
+				thrown = std::string(e.reason()) == "unexpected end of input";
+			}
+			assert(thrown && parser.ready() == 2);
+			thrown = false;
+			try {
+				StreamParser strict;
+				strict.feed("1, 2");
+			} catch (const JSONError& e) {
+				thrown = e.offset() == 1;
+			}
+			assert(thrown);
+		}
+		// 64-bit integers stay exact, other numbers are correctly rounded
+		JSONObject ints = parse("[9007199254740993, -9223372036854775808, 18446744073709551615, 42, -0]");
+		assert(ints.get<int64_t>(0) == INT64_C(9007199254740993));
+		assert(ints.get<int64_t>(1) == INT64_MIN);
+		assert(ints.get<uint64_t>(2) == UINT64_MAX);
+		assert(ints.get<int>(3) == 42);
+		assert(ints.print(false) == "[9007199254740993,-9223372036854775808,18446744073709551615,42,0]");
+		JSONObject wide;
+		wide.set("id", static_cast<int64_t>(INT64_C(1234567890123456789)));
+		wide.set("uid", static_cast<uint64_t>(UINT64_MAX));
+		assert(wide.print(false) == "{\"id\":1234567890123456789,\"uid\":18446744073709551615}");
+		const char* floats[] = {"0.1", "3.141592653589793", "2.2250738585072011e-308", "4.9e-324",
+								"1.7976931348623157e308", "9007199254740993.0", "1e23", "-7.5e-7",
+								"123456789012345678901234567890", "0.000000000000000000000000000001e30",
+								"8.98846567431158e307", "1e-400", "1e400"};
+		for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); i++)
+			assert(parse(floats[i]).as<double>() == strtod(floats[i], NULL));
+		try {
+			ints.get<uint64_t>(1);
+			assert(false);
+		} catch (const JSONError&) {
+		}
+		// doubles print in the shortest form that reads back the same
+		JSONObject fmt = arrayObject();
+		const double shown[] = {0.1, 100.1, -2.5, 1e21, 1e-7, 123456789.125, 5e-324, 1.7976931348623157e308, -0.0};
+		for (size_t i = 0; i < sizeof(shown) / sizeof(shown[0]); i++)
+			fmt.add(shown[i]);
+		assert(fmt.print(false) == "[0.1,100.1,-2.5,1e+21,1e-7,123456789.125,5e-324,1.7976931348623157e+308,0]");
+		JSONObject roundTrip = arrayObject();
+		uint64_t bits = UINT64_C(0x9E3779B97F4A7C15);
+		for (int i = 0; i < 100000; i++) {
+			bits ^= bits << 13;
+			bits ^= bits >> 7;
+			bits ^= bits << 17;
+			double d;
+			memcpy(&d, &bits, sizeof(d));
+			if (d == d && d - d == 0)
+				roundTrip.add(i % 2 ? d : static_cast<double>(bits % 1000000) / 1000);
+		}
+		std::vector<double> printed = parse(roundTrip.print(false)).asArray<double, std::vector>();
+		std::vector<double> added = roundTrip.asArray<double, std::vector>();
+		assert(printed == added);
+		// print into memory the caller owns
+		{
+			JSONObject doc = parse("{\"a\": [1, 2.5, \"x\"], \"b\": {\"c\": null}}");
+			std::string expected = doc.print(false);
+			std::string out(1000, 'z');
+			assert(doc.print_to(out, false) == expected.size() && out == expected);
+			out.clear();
+			assert(doc.print_to(out) == out.size() && out == doc.print());
+			char small[8];
+			size_t need = doc.print_to(small, sizeof(small), false);
+			assert(need == expected.size());
+			std::vector<char> buf(need + 1);
+			assert(doc.print_to(&buf[0], buf.size(), false) == need && expected == &buf[0]);
+#ifdef WITH_CPP11
+			// a bare buffer is not an output iterator, and needs its size
+			static_assert(!PrintsTo<char*, bool>::value, "print_to(buf, false) must not compile");
+			static_assert(PrintsTo<char*, int>::value, "print_to(buf, cap) must compile");
+#endif
+			std::vector<char> chars;
+			doc.print_to(std::back_inserter(chars), false);
+			assert(std::string(chars.begin(), chars.end()) == expected);
+			JSONObject many = arrayObject();
+			for (int i = 0; i < 2000; i++)
+				many.add(expected);
+			std::string streamed;
+			many.print_to(std::back_inserter(streamed));
+			assert(streamed == many.print());
+
+			// escapes between runs of plain bytes
+			JSONObject text = arrayObject();
+			text.add(std::string("\x01\x1f\b\f\n\r\t\"\\/\x7f"));
+			text.add(std::string(40, 'x') + '"' + std::string(40, 'y') + '\x0b');
+			assert(text.print(false) == "[\"\\u0001\\u001f\\b\\f\\n\\r\\t\\\"\\\\/\x7f\",\""
+				   + std::string(40, 'x') + "\\\"" + std::string(40, 'y') + "\\u000b\"]");
+			assert(parse(text.print()).get<std::string>(1) == text.get<std::string>(1));
+
+#ifdef WITH_CPP11
+			// threads may print the same cached document at once
+			{
+				std::string printed[2];
+				std::thread other([&] { for (int i = 0; i < 50; i++) many.print_to(printed[1], false); });
+				for (int i = 0; i < 50; i++)
+					many.print_to(printed[0], false);
+				other.join();
+				assert(printed[0] == printed[1] && printed[0] == many.print(false));
+			}
+#endif
+			// exact length without printing, one allocation per print
+			const char* shapes[] = { "{}", "[]", "{\"a\": {}, \"b\": [{}, [], {\"c\": {}}]}",
+				"[\"tab\\tquote\\\"\\u0001\\u00e9\", -0.5, 1e300, 18446744073709551615, true, false, null]" };
+			for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+				JSONObject shape = parse(shapes[i]);
+				assert(shape.printed_length() == shape.print().size());
+				assert(shape.printed_length(false) == shape.print(false).size());
+				char* buffered = cJSON_PrintBuffered(shape.obj(), 0, 1);
+				assert(buffered == shape.print());
+				free(buffered);
+			}
+			assert(doc.printed_length(false) == expected.size());
+			JSONObject grown = parse("[1]");
+			assert(grown.print(false) == "[1]");
+			grown.add(std::string(100, 'x'));
+			assert(grown.print(false) == "[1," + std::string(1, '"') + std::string(100, 'x') + '"' + "]");
+			assert(grown.printed_length(false) == 106);
+
+			// stream in bounded chunks
+			std::ostringstream os;
+			assert(many.print_to(os, true, 256) == streamed.size() && os.str() == streamed);
+			std::ostringstream whole;
+			doc.print_to(whole, false);
+			assert(whole.str() == expected);
+			std::ostringstream shifted;
+			shifted << doc;
+			assert(shifted.str() == doc.print());
+			std::string collected;
+			ChunkCollector collect = { &collected, 0, 1000000 };
+			assert(many.print_chunks(collect, false, 512) == many.print(false).size());
+			assert(collected == many.print(false));
+			ChunkCollector refuse = { &collected, 0, 2 };
+			bool thrown = false;
+			try {
+				many.print_chunks(refuse, false, 512);
+			} catch (const JSONError&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+#ifdef WITH_CPP17
+		std::string_view view("[1, 2]xyz");
+		assert(parse(view.substr(0, 6)).asArray<int>().size() == 2);
+#endif
 
 	} catch (const JSONError& e) {
 		std::cout << e.what() << '\n';